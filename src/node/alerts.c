@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <dirent.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "alerts.h"
+
+#define ALERT_FIELDS 256
+#define ALERT_NAME_SIZE 128
+#define ALERT_RANGE_SIZE 64
+#define ALERT_LINE_SIZE 512
+
+struct limit {
+	char name[ALERT_NAME_SIZE];
+	char type[16];
+	char warning[ALERT_RANGE_SIZE];
+	char critical[ALERT_RANGE_SIZE];
+	bool has_last;		/* previous sample, for the rates */
+	long last_ts;
+	double last;
+};
+
+static int nb_limits;
+static struct limit limits[ALERT_FIELDS];
+
+typedef void (*attr_callback) (const char *name, const char *attr,
+			       const char *value);
+
+/* Call cb for each "field.attr value" line of a plugin output, the field
+ * being prefixed with its graph if it is not the plugin's own. */
+static void parse_output(const char *plugin, const char *output,
+			 attr_callback cb)
+{
+	char graph[ALERT_NAME_SIZE] = "", line[ALERT_LINE_SIZE];
+	char name[ALERT_NAME_SIZE * 2];
+	const char *s, *next;
+
+	for (s = output; *s; s = next) {
+		char *value, *dot;
+		size_t len;
+
+		next = s + strcspn(s, "\n");
+		len = next - s;
+		if (*next)
+			next++;
+		if (len >= sizeof(line))
+			continue;
+		memcpy(line, s, len);
+		line[len] = '\0';
+
+		if (!strncmp(line, "multigraph ", 11)) {
+			snprintf(graph, sizeof(graph), "%s",
+				 strcmp(line + 11, plugin) ? line + 11 : "");
+			continue;
+		}
+		if (!(value = strchr(line, ' ')))
+			continue;
+		*value++ = '\0';
+		if (!(dot = strrchr(line, '.')))
+			continue;
+		*dot = '\0';
+		snprintf(name, sizeof(name), "%s%s%s", graph,
+			 graph[0] ? "." : "", line);
+		cb(name, dot + 1, value);
+	}
+}
+
+static struct limit *find_limit(const char *name, bool create)
+{
+	int i;
+
+	for (i = 0; i < nb_limits; i++)
+		if (!strcmp(limits[i].name, name))
+			return limits + i;
+	if (!create || nb_limits == ALERT_FIELDS
+	    || strlen(name) >= ALERT_NAME_SIZE)
+		return NULL;
+	memset(limits + nb_limits, 0, sizeof(limits[0]));
+	strcpy(limits[nb_limits].name, name);
+	strcpy(limits[nb_limits].type, "GAUGE");
+	return limits + nb_limits++;
+}
+
+static void config_attr(const char *name, const char *attr,
+			const char *value)
+{
+	struct limit *l;
+
+	if (strcmp(attr, "warning") && strcmp(attr, "critical")
+	    && strcmp(attr, "type"))
+		return;
+	if (!(l = find_limit(name, true)))
+		return;
+	if (!strcmp(attr, "warning"))
+		snprintf(l->warning, sizeof(l->warning), "%s", value);
+	else if (!strcmp(attr, "critical"))
+		snprintf(l->critical, sizeof(l->critical), "%s", value);
+	else
+		snprintf(l->type, sizeof(l->type), "%s", value);
+}
+
+/* Replace path with what was written to path.tmp */
+static int commit(FILE *f, const char *path)
+{
+	char tmp[PATH_MAX];
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if (fclose(f) != 0 || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+static FILE *create_tmp(const char *path)
+{
+	char tmp[PATH_MAX];
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	return fopen(tmp, "w");
+}
+
+int alerts_config(const char *dir, const char *plugin, const char *output)
+{
+	char path[PATH_MAX];
+	int i, nb = 0;
+	FILE *f;
+
+	nb_limits = 0;
+	parse_output(plugin, output, config_attr);
+
+	snprintf(path, sizeof(path), "%s/%s.limits", dir, plugin);
+	if (!(f = create_tmp(path)))
+		return -1;
+	for (i = 0; i < nb_limits; i++) {
+		const struct limit *l = limits + i;
+
+		if (!l->warning[0] && !l->critical[0])
+			continue;
+		fprintf(f, "%s %s %s %s\n", l->name, l->type,
+			l->warning[0] ? l->warning : "-",
+			l->critical[0] ? l->critical : "-");
+		nb++;
+	}
+	if (commit(f, path) < 0)
+		return -1;
+
+	if (nb == 0) {
+		/* Nothing to check, nor to report anymore */
+		unlink(path);
+		snprintf(path, sizeof(path), "%s/%s.alerts", dir, plugin);
+		unlink(path);
+	}
+	return 0;
+}
+
+/* Whether v is within a Munin range */
+static bool in_range(const char *range, double v)
+{
+	const char *colon = strchr(range, ':');
+	char *end;
+	double bound;
+
+	if (!colon) {
+		bound = strtod(range, &end);
+		return end == range || v <= bound;
+	}
+	bound = strtod(range, &end);
+	if (end != range && v < bound)
+		return false;
+	bound = strtod(colon + 1, &end);
+	if (end != colon + 1 && v > bound)
+		return false;
+	return true;
+}
+
+static FILE *alerts_out;
+static time_t fetch_time;
+
+static void fetch_attr(const char *name, const char *attr, const char *value)
+{
+	const char *colon;
+	struct limit *l;
+	long ts = fetch_time;
+	double raw, v;
+	char *end;
+
+	if (strcmp(attr, "value") || !(l = find_limit(name, false)))
+		return;
+	if ((colon = strchr(value, ':'))) {
+		ts = atol(value);
+		value = colon + 1;
+	}
+	raw = strtod(value, &end);
+	if (end == value)
+		return;		/* U */
+
+	if (!strcmp(l->type, "GAUGE")) {
+		v = raw;
+	} else {
+		bool has_last = l->has_last && ts > l->last_ts;
+		double last = l->last;
+		long dt = ts - l->last_ts;
+
+		l->has_last = true;
+		l->last_ts = ts;
+		l->last = raw;
+		if (!has_last)
+			return;
+		if (!strcmp(l->type, "ABSOLUTE"))
+			v = raw / dt;
+		else
+			v = (raw - last) / dt;
+		if (v < 0 && !strcmp(l->type, "COUNTER"))
+			return;	/* wrapped or reset */
+	}
+
+	if (l->critical[0] && !in_range(l->critical, v))
+		fprintf(alerts_out, "alert %s critical %.10g %s\n", l->name,
+			v, l->critical);
+	else if (l->warning[0] && !in_range(l->warning, v))
+		fprintf(alerts_out, "alert %s warning %.10g %s\n", l->name,
+			v, l->warning);
+}
+
+static int load_limits(const char *dir, const char *plugin)
+{
+	char path[PATH_MAX], line[ALERT_LINE_SIZE];
+	char name[ALERT_NAME_SIZE], a[ALERT_RANGE_SIZE], b[ALERT_RANGE_SIZE];
+	struct limit *l;
+	double last;
+	long ts;
+	FILE *f;
+
+	nb_limits = 0;
+	snprintf(path, sizeof(path), "%s/%s.limits", dir, plugin);
+	if (!(f = fopen(path, "r")))
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		char type[16];
+
+		if (4 != sscanf(line, "%127s %15s %63s %63s", name, type, a, b)
+		    || !(l = find_limit(name, true)))
+			continue;
+		snprintf(l->type, sizeof(l->type), "%s", type);
+		snprintf(l->warning, sizeof(l->warning), "%s",
+			 strcmp(a, "-") ? a : "");
+		snprintf(l->critical, sizeof(l->critical), "%s",
+			 strcmp(b, "-") ? b : "");
+	}
+	fclose(f);
+
+	/* The previous samples */
+	snprintf(path, sizeof(path), "%s/%s.alerts", dir, plugin);
+	if (!(f = fopen(path, "r")))
+		return 0;
+	while (fgets(line, sizeof(line), f))
+		if (3 == sscanf(line, "last %127s %ld %lf", name, &ts, &last)
+		    && (l = find_limit(name, false))) {
+			l->has_last = true;
+			l->last_ts = ts;
+			l->last = last;
+		}
+	fclose(f);
+	return 0;
+}
+
+int alerts_fetch(const char *dir, const char *plugin, const char *output,
+		 time_t now)
+{
+	char path[PATH_MAX];
+	int i;
+
+	if (load_limits(dir, plugin) < 0)
+		return 0;
+
+	snprintf(path, sizeof(path), "%s/%s.alerts", dir, plugin);
+	if (!(alerts_out = create_tmp(path)))
+		return -1;
+	fetch_time = now;
+	parse_output(plugin, output, fetch_attr);
+	for (i = 0; i < nb_limits; i++)
+		if (limits[i].has_last)
+			fprintf(alerts_out, "last %s %ld %.17g\n",
+				limits[i].name, limits[i].last_ts,
+				limits[i].last);
+	return commit(alerts_out, path);
+}
+
+void alerts_list(const char *dir)
+{
+	DIR *dirp = opendir(dir);
+	struct dirent *dp;
+
+	if (dirp == NULL)
+		return;
+	while ((dp = readdir(dirp)) != NULL) {
+		char path[PATH_MAX], line[ALERT_LINE_SIZE];
+		size_t len = strlen(dp->d_name);
+		FILE *f;
+
+		if (dp->d_name[0] == '.' || len <= 7
+		    || strcmp(dp->d_name + len - 7, ".alerts"))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, dp->d_name);
+		if (!(f = fopen(path, "r")))
+			continue;
+		while (fgets(line, sizeof(line), f))
+			if (!strncmp(line, "alert ", 6))
+				printf("%.*s %s", (int) len - 7, dp->d_name,
+				       line + 6);
+		fclose(f);
+	}
+	closedir(dirp);
+}
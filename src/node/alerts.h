@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <time.h>
+
+/** The warning and critical ranges of a plugin are taken from its config
+ * output and kept in <dir>/<plugin>.limits. Each fetch is then checked
+ * against them, and the fields out of range are written to
+ * <dir>/<plugin>.alerts, which also keeps the previous value of the
+ * DERIVE, COUNTER and ABSOLUTE fields, since ranges apply to their rate.
+ *
+ * Ranges follow Munin: "max", "min:max", "min:" or ":max". CDEFs are not
+ * evaluated. Fields of multigraph plugins are named "graph.field". */
+
+/** Cache the ranges found in a config output.
+ * @returns 0 on success, -1 on error */
+int alerts_config(const char *dir, const char *plugin, const char *output);
+
+/** Check a fetch output, done at the given time, against the cached ranges.
+ * @returns 0 on success or if the plugin has no range, -1 on error */
+int alerts_fetch(const char *dir, const char *plugin, const char *output,
+		 time_t now);
+
+/** Print the fields out of range for every plugin, as
+ * "<plugin> <field> warning|critical <value> <range>" lines. */
+void alerts_list(const char *dir);
+
+#endif
@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binenc.h"
+
+#define BINENC_NAME_SIZE 256
+
+/* A growing frame payload */
+struct payload {
+	unsigned char *data;
+	size_t len, size;
+};
+
+static int put_bytes(struct payload *p, const void *data, size_t len)
+{
+	if (p->len + len > p->size) {
+		size_t size = p->size ? p->size : 4096;
+		unsigned char *data;
+
+		while (size < p->len + len)
+			size *= 2;
+		if (!(data = realloc(p->data, size)))
+			return -1;
+		p->data = data;
+		p->size = size;
+	}
+	memcpy(p->data + p->len, data, len);
+	p->len += len;
+	return 0;
+}
+
+static int put_byte(struct payload *p, unsigned char c)
+{
+	return put_bytes(p, &c, 1);
+}
+
+static int put_varint(struct payload *p, uint64_t v)
+{
+	unsigned char buf[10];
+	size_t n = 0;
+
+	while (v >= 0x80) {
+		buf[n++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	buf[n++] = v;
+	return put_bytes(p, buf, n);
+}
+
+static int put_string(struct payload *p, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (put_varint(p, len) < 0)
+		return -1;
+	return put_bytes(p, s, len);
+}
+
+static int put_double(struct payload *p, double v)
+{
+	unsigned char buf[8];
+	uint64_t bits;
+	int i;
+
+	memcpy(&bits, &v, sizeof(bits));
+	for (i = 0; i < 8; i++)
+		buf[i] = bits >> (8 * i);
+	return put_bytes(p, buf, sizeof(buf));
+}
+
+static int send_frame(int type, struct payload *p, FILE *out)
+{
+	struct payload header = { NULL, 0, 0 };
+	int ret = 0;
+
+	if (put_byte(&header, type) < 0 || put_varint(&header, p->len) < 0)
+		ret = -1;
+	else if (fwrite(header.data, 1, header.len, out) != header.len
+		 || fwrite(p->data, 1, p->len, out) != p->len)
+		ret = -1;
+	free(header.data);
+	return ret;
+}
+
+/* FNV-1a of the graph and the name */
+static unsigned hash_field(const char *graph, const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *graph; graph++)
+		h = (h ^ (unsigned char) *graph) * 16777619u;
+	h = (h ^ '.') * 16777619u;
+	for (; *name; name++)
+		h = (h ^ (unsigned char) *name) * 16777619u;
+	return h;
+}
+
+/* @returns the slot of the field, or the empty one where it belongs */
+static unsigned field_slot(const struct binenc *e, const char *graph,
+			   const char *name)
+{
+	unsigned i = hash_field(graph, name) & (e->hash_size - 1);
+
+	while (e->hash[i]) {
+		const struct binenc_field *f = e->fields + e->hash[i] - 1;
+
+		if (!strcmp(f->name, name) && !strcmp(f->graph, graph))
+			break;
+		i = (i + 1) & (e->hash_size - 1);
+	}
+	return i;
+}
+
+/* Keep the table at most half full */
+static int grow_hash(struct binenc *e)
+{
+	unsigned size = e->hash_size ? e->hash_size * 2 : 256;
+	unsigned *old = e->hash, old_size = e->hash_size, i;
+
+	if (!(e->hash = calloc(size, sizeof(*e->hash)))) {
+		e->hash = old;
+		return -1;
+	}
+	e->hash_size = size;
+	for (i = 0; i < old_size; i++)
+		if (old[i]) {
+			const struct binenc_field *f = e->fields + old[i] - 1;
+			e->hash[field_slot(e, f->graph, f->name)] = old[i];
+		}
+	free(old);
+	return 0;
+}
+
+static int add_field(struct binenc *e, unsigned id, const char *graph,
+		     const char *name)
+{
+	struct binenc_field *f;
+
+	if (id >= e->size) {
+		unsigned size = e->size ? e->size : 64;
+
+		while (size <= id)
+			size *= 2;
+		if (!(f = realloc(e->fields, size * sizeof(*f))))
+			return -1;
+		memset(f + e->size, 0, (size - e->size) * sizeof(*f));
+		e->fields = f;
+		e->size = size;
+	}
+	f = e->fields + id;
+	free(f->graph);
+	free(f->name);
+	f->graph = strdup(graph);
+	f->name = strdup(name);
+	if (!f->graph || !f->name)
+		return -1;
+	if (id >= e->nb_fields)
+		e->nb_fields = id + 1;
+	return 0;
+}
+
+/* @returns the id of the field, adding it to the dictionary payload when
+ * new, or -1 on error */
+static long field_id(struct binenc *e, const char *graph, const char *name,
+		     struct payload *dict)
+{
+	unsigned slot, id;
+
+	if (2 * (e->nb_fields + 1) > e->hash_size && grow_hash(e) < 0)
+		return -1;
+	slot = field_slot(e, graph, name);
+	if (e->hash[slot])
+		return e->hash[slot] - 1;
+
+	id = e->nb_fields;
+	if (add_field(e, id, graph, name) < 0)
+		return -1;
+	e->hash[slot] = id + 1;
+	if (put_varint(dict, id) < 0 || put_string(dict, graph) < 0
+	    || put_string(dict, name) < 0)
+		return -1;
+	return id;
+}
+
+typedef int (*line_callback) (struct binenc *e, const char *graph,
+			      const char *name, const char *attr,
+			      const char *value, struct payload *dict,
+			      struct payload *values);
+
+/* Call cb for each "name.attr value" line of a plugin output */
+static int parse_output(struct binenc *e, const char *output,
+			line_callback cb, struct payload *dict,
+			struct payload *values)
+{
+	char graph[BINENC_NAME_SIZE] = "", line[BINENC_NAME_SIZE * 2];
+	const char *s, *next;
+
+	for (s = output; *s; s = next) {
+		char *value, *dot;
+		size_t len;
+
+		next = s + strcspn(s, "\n");
+		len = next - s;
+		if (*next)
+			next++;
+		if (len >= sizeof(line))
+			continue;
+		memcpy(line, s, len);
+		line[len] = '\0';
+
+		if (!strncmp(line, "multigraph ", 11)) {
+			snprintf(graph, sizeof(graph), "%s", line + 11);
+			continue;
+		}
+		if (!(value = strchr(line, ' ')) || line[0] == '#')
+			continue;
+		*value++ = '\0';
+		if (!(dot = strrchr(line, '.')))
+			continue;
+		*dot = '\0';
+		if (cb(e, graph, line, dot + 1, value, dict, values) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int config_line(struct binenc *e, const char *graph,
+		       const char *name, const char *attr, const char *value,
+		       struct payload *dict, struct payload *values)
+{
+	(void) attr;
+	(void) value;
+	(void) values;
+	return field_id(e, graph, name, dict) < 0 ? -1 : 0;
+}
+
+/* @returns the tag of a value, setting its integer or double, or -1 when
+ * it is not a number */
+static int classify(const char *value, uint64_t *v, double *d)
+{
+	char *end;
+
+	if (!strcmp(value, "U"))
+		return BINENC_UNKNOWN;
+	errno = 0;
+	if (value[0] == '-') {
+		long long i = strtoll(value, &end, 10);
+		if (!*end && end != value && !errno) {
+			/* zigzag */
+			*v = ((uint64_t) i << 1) ^ (uint64_t) (i >> 63);
+			return BINENC_INT;
+		}
+	} else if (isdigit((unsigned char) value[0])) {
+		*v = strtoull(value, &end, 10);
+		if (!*end && !errno)
+			return BINENC_UINT;
+	}
+	*d = strtod(value, &end);
+	return *end || end == value ? -1 : BINENC_FLOAT;
+}
+
+static int encode_value(struct payload *p, const char *value)
+{
+	const char *colon = strchr(value, ':');
+	uint64_t ts = 0, v = 0;
+	double d = 0;
+	char *end;
+	int tag;
+
+	if (colon) {
+		ts = strtoull(value, &end, 10);
+		if (end != colon)
+			return -1;
+		value = colon + 1;
+	}
+	if ((tag = classify(value, &v, &d)) < 0)
+		return -1;
+
+	if (put_byte(p, tag | (colon ? BINENC_TIMESTAMP : 0)) < 0
+	    || (colon && put_varint(p, ts) < 0))
+		return -1;
+	if (tag == BINENC_FLOAT)
+		return put_double(p, d);
+	if (tag != BINENC_UNKNOWN)
+		return put_varint(p, v);
+	return 0;
+}
+
+static int fetch_line(struct binenc *e, const char *graph, const char *name,
+		      const char *attr, const char *value,
+		      struct payload *dict, struct payload *values)
+{
+	size_t len = values->len;
+	long id;
+
+	if (strcmp(attr, "value"))
+		return 0;
+	if ((id = field_id(e, graph, name, dict)) < 0
+	    || put_varint(values, id) < 0)
+		return -1;
+	if (encode_value(values, value) < 0)
+		values->len = len;	/* not a number, dropped */
+	return 0;
+}
+
+int binenc_config(struct binenc *e, const char *output, FILE *out)
+{
+	struct payload dict = { NULL, 0, 0 };
+	int ret;
+
+	ret = parse_output(e, output, config_line, &dict, NULL);
+	if (ret == 0)
+		ret = send_frame(BINENC_DICT, &dict, out);
+	free(dict.data);
+	return ret;
+}
+
+int binenc_fetch(struct binenc *e, const char *output, FILE *out)
+{
+	struct payload dict = { NULL, 0, 0 }, values = { NULL, 0, 0 };
+	int ret;
+
+	ret = parse_output(e, output, fetch_line, &dict, &values);
+	if (ret == 0 && dict.len)
+		ret = send_frame(BINENC_DICT, &dict, out);
+	if (ret == 0)
+		ret = send_frame(BINENC_VALUES, &values, out);
+	free(dict.data);
+	free(values.data);
+	return ret;
+}
+
+/* The reading side, over a payload read whole */
+struct reader {
+	const unsigned char *data;
+	size_t len, pos;
+};
+
+static int get_varint(struct reader *r, uint64_t *v)
+{
+	int shift = 0;
+
+	*v = 0;
+	while (r->pos < r->len && shift < 64) {
+		unsigned char c = r->data[r->pos++];
+
+		*v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+		shift += 7;
+	}
+	return -1;
+}
+
+static int read_varint(FILE *in, uint64_t *v)
+{
+	int shift = 0, c;
+
+	*v = 0;
+	while ((c = getc(in)) != EOF && shift < 64) {
+		*v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+		shift += 7;
+	}
+	return -1;
+}
+
+static char *get_string(struct reader *r)
+{
+	uint64_t len;
+	char *s;
+
+	if (get_varint(r, &len) < 0 || len > r->len - r->pos
+	    || !(s = malloc(len + 1)))
+		return NULL;
+	memcpy(s, r->data + r->pos, len);
+	s[len] = '\0';
+	r->pos += len;
+	return s;
+}
+
+static int decode_dict(struct binenc *d, struct reader *r)
+{
+	while (r->pos < r->len) {
+		char *graph = NULL, *name = NULL;
+		uint64_t id;
+		int ret;
+
+		if (get_varint(r, &id) < 0 || id > 1 << 24
+		    || !(graph = get_string(r)) || !(name = get_string(r))) {
+			free(graph);
+			return -1;
+		}
+		ret = add_field(d, id, graph, name);
+		free(graph);
+		free(name);
+		if (ret < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* The shortest representation reading back as v */
+static void print_double(FILE *out, double v)
+{
+	char buf[32];
+	int precision;
+
+	for (precision = 1; precision < 17; precision++) {
+		snprintf(buf, sizeof(buf), "%.*g", precision, v);
+		if (strtod(buf, NULL) == v)
+			break;
+	}
+	snprintf(buf, sizeof(buf), "%.*g", precision, v);
+	fputs(buf, out);
+}
+
+static int decode_values(struct binenc *d, struct reader *r, FILE *out)
+{
+	const char *graph = "";
+
+	while (r->pos < r->len) {
+		const struct binenc_field *f;
+		uint64_t id, ts, v;
+		int tag;
+
+		if (get_varint(r, &id) < 0 || id >= d->nb_fields
+		    || !d->fields[id].name || r->pos == r->len)
+			return -1;
+		f = d->fields + id;
+		tag = r->data[r->pos++];
+
+		if (strcmp(graph, f->graph)) {
+			graph = f->graph;
+			fprintf(out, "multigraph %s\n", graph);
+		}
+		fprintf(out, "%s.value ", f->name);
+		if (tag & BINENC_TIMESTAMP) {
+			if (get_varint(r, &ts) < 0)
+				return -1;
+			fprintf(out, "%llu:", (unsigned long long) ts);
+		}
+
+		switch (tag & ~BINENC_TIMESTAMP) {
+		case BINENC_UNKNOWN:
+			fputs("U", out);
+			break;
+		case BINENC_UINT:
+			if (get_varint(r, &v) < 0)
+				return -1;
+			fprintf(out, "%llu", (unsigned long long) v);
+			break;
+		case BINENC_INT:
+			if (get_varint(r, &v) < 0)
+				return -1;
+			fprintf(out, "%lld", (long long) (v >> 1)
+				^ -(long long) (v & 1));
+			break;
+		case BINENC_FLOAT:{
+				double value;
+				int i;
+
+				if (r->len - r->pos < 8)
+					return -1;
+				for (v = 0, i = 7; i >= 0; i--)
+					v = v << 8 | r->data[r->pos + i];
+				r->pos += 8;
+				memcpy(&value, &v, sizeof(value));
+				print_double(out, value);
+				break;
+			}
+		default:
+			return -1;
+		}
+		fputc('\n', out);
+	}
+	return 0;
+}
+
+int binenc_decode(struct binenc *d, FILE *in, FILE *out)
+{
+	struct reader r = { NULL, 0, 0 };
+	unsigned char *data;
+	uint64_t len;
+	int type, ret;
+
+	if ((type = getc(in)) == EOF)
+		return 0;
+	if (read_varint(in, &len) < 0 || len > SIZE_MAX
+	    || !(data = malloc(len ? len : 1)))
+		return -1;
+	if (fread(data, 1, len, in) != len) {
+		free(data);
+		return -1;
+	}
+	r.data = data;
+	r.len = len;
+
+	if (type == BINENC_DICT)
+		ret = decode_dict(d, &r);
+	else if (type == BINENC_VALUES)
+		ret = decode_values(d, &r, out);
+	else
+		ret = 0;	/* unknown frames are skipped */
+	free(data);
+	return ret < 0 ? -1 : type;
+}
+
+void binenc_free(struct binenc *e)
+{
+	unsigned i;
+
+	for (i = 0; i < e->size; i++) {
+		free(e->fields[i].graph);
+		free(e->fields[i].name);
+	}
+	free(e->fields);
+	free(e->hash);
+	memset(e, 0, sizeof(*e));
+}
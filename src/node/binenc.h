@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef BINENC_H
+#define BINENC_H
+
+#include <stdio.h>
+
+/** The binary encoding of fetch outputs, used once a master announces
+ * "binary" in its cap command.
+ *
+ * It is a sequence of frames: a type byte, the payload length as an
+ * unsigned varint (LEB128) and the payload.
+ *
+ * A 'D' frame extends the dictionary of the session. Its payload is a
+ * sequence of entries: the id given to the field, the length of its graph
+ * and the graph, the length of its name and the name, all lengths and ids
+ * being varints. The graph is empty for the plugin's own graph.
+ *
+ * A 'V' frame holds the values of a fetch: a sequence of the field id, a
+ * tag byte, the timestamp as a varint when the tag has BINENC_TIMESTAMP
+ * set, and the value, as told by the tag: nothing for BINENC_UNKNOWN, a
+ * varint for BINENC_UINT, a zigzag varint for BINENC_INT and a little
+ * endian IEEE 754 double for BINENC_FLOAT.
+ *
+ * The fields of a config output are sent in a 'D' frame following it,
+ * empty when they were all sent already, so that a master always knows
+ * where the frame ends and the next answer begins. The answer to a fetch
+ * is a 'D' frame if it has fields not seen yet, and a 'V' frame, which
+ * ends it. */
+
+#define BINENC_DICT 'D'
+#define BINENC_VALUES 'V'
+
+#define BINENC_UNKNOWN 0
+#define BINENC_UINT 1
+#define BINENC_INT 2
+#define BINENC_FLOAT 3
+#define BINENC_TIMESTAMP 0x80
+
+struct binenc_field {
+	char *graph;
+	char *name;
+};
+
+/** The dictionary of a session, zero initialized. */
+struct binenc {
+	struct binenc_field *fields;
+	unsigned nb_fields, size;
+	unsigned *hash;		/* field id + 1, 0 for a free slot */
+	unsigned hash_size;
+};
+
+/** Send the dictionary entries of the fields of a config output not sent
+ * yet, in a 'D' frame sent even when empty.
+ * @returns 0 on success, -1 on error */
+int binenc_config(struct binenc *e, const char *output, FILE *out);
+
+/** Encode the values of a fetch output, "field.value [timestamp:]value"
+ * lines with optional "multigraph" lines, other lines being dropped.
+ * @returns 0 on success, -1 on error */
+int binenc_fetch(struct binenc *e, const char *output, FILE *out);
+
+/** Read a frame, printing the lines of a 'V' frame in the text protocol.
+ * The dictionary is filled from the 'D' frames.
+ * @returns the frame type, 0 at the end of the input or -1 on error */
+int binenc_decode(struct binenc *d, FILE *in, FILE *out);
+
+/** Free the dictionary. */
+void binenc_free(struct binenc *e);
+
+#endif
@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history.h"
+
+#define HIST_MAGIC 0x5349484d	/* "MHIS" */
+#define HIST_VERSION 1
+#define HIST_FIELDS 256
+#define HIST_NAME_SIZE 64
+#define HIST_BLOCKS 256
+#define HIST_BLOCK_SIZE 512
+#define HIST_FREE 0xffff
+
+/* The worst case of a sample: 4 + 32 bits of timestamp, 2 + 5 + 6 + 64 of
+ * value. A block with less room left is full. */
+#define HIST_SAMPLE_MAX_BITS 113
+
+struct hist_block {
+	uint16_t field;		/* HIST_FREE if unused */
+	uint16_t count;
+	uint16_t nbits;
+	uint8_t leading;	/* XOR window of the last value, 0xff if none */
+	uint8_t trailing;
+	int64_t first_ts;
+	int64_t last_ts;
+	int64_t last_delta;
+	uint64_t first_value;
+	uint64_t last_value;
+	uint8_t data[HIST_BLOCK_SIZE - 48];
+};
+
+struct hist_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nb_blocks;
+	uint32_t head;		/* the oldest block, reused next */
+	int32_t current[HIST_FIELDS];	/* the block being filled, or -1 */
+	char names[HIST_FIELDS][HIST_NAME_SIZE];
+};
+
+struct hist_file {
+	int fd;
+	size_t size;
+	struct hist_header *h;
+	struct hist_block *blocks;
+};
+
+struct bit_reader {
+	const uint8_t *data;
+	unsigned int pos, end;
+};
+
+static void put_bits(struct hist_block *b, uint64_t value, int n)
+{
+	while (n--) {
+		if (value >> n & 1)
+			b->data[b->nbits >> 3] |= 0x80 >> (b->nbits & 7);
+		b->nbits++;
+	}
+}
+
+static uint64_t get_bits(struct bit_reader *r, int n)
+{
+	uint64_t value = 0;
+
+	while (n--) {
+		value <<= 1;
+		if (r->pos < r->end)
+			value |=
+			    r->data[r->pos >> 3] >> (7 - (r->pos & 7)) & 1;
+		r->pos++;
+	}
+	return value;
+}
+
+static uint64_t double_bits(double d)
+{
+	uint64_t u;
+
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+static double bits_double(uint64_t u)
+{
+	double d;
+
+	memcpy(&d, &u, sizeof(d));
+	return d;
+}
+
+/* Timestamps: the delta of deltas in the smallest of 5 classes */
+static void put_timestamp(struct hist_block *b, int64_t ts)
+{
+	int64_t delta = ts - b->last_ts, dod = delta - b->last_delta;
+
+	if (dod == 0) {
+		put_bits(b, 0, 1);
+	} else if (dod >= -63 && dod <= 64) {
+		put_bits(b, 2, 2);
+		put_bits(b, dod + 63, 7);
+	} else if (dod >= -255 && dod <= 256) {
+		put_bits(b, 6, 3);
+		put_bits(b, dod + 255, 9);
+	} else if (dod >= -2047 && dod <= 2048) {
+		put_bits(b, 14, 4);
+		put_bits(b, dod + 2047, 12);
+	} else {
+		put_bits(b, 15, 4);
+		put_bits(b, (uint32_t) dod, 32);
+	}
+	b->last_delta = delta;
+	b->last_ts = ts;
+}
+
+static int64_t get_timestamp(struct bit_reader *r, int64_t *delta)
+{
+	if (!get_bits(r, 1))
+		return *delta;
+	if (!get_bits(r, 1))
+		return *delta += (int64_t) get_bits(r, 7) - 63;
+	if (!get_bits(r, 1))
+		return *delta += (int64_t) get_bits(r, 9) - 255;
+	if (!get_bits(r, 1))
+		return *delta += (int64_t) get_bits(r, 12) - 2047;
+	return *delta += (int32_t) get_bits(r, 32);
+}
+
+/* Values: the XOR with the previous one, reusing its window of
+ * meaningful bits when it fits */
+static void put_value(struct hist_block *b, uint64_t value)
+{
+	uint64_t x = value ^ b->last_value;
+	int leading, trailing;
+
+	b->last_value = value;
+	if (x == 0) {
+		put_bits(b, 0, 1);
+		return;
+	}
+	leading = __builtin_clzll(x);
+	trailing = __builtin_ctzll(x);
+	if (leading > 31)
+		leading = 31;
+	if (b->leading != 0xff && leading >= b->leading
+	    && trailing >= b->trailing) {
+		put_bits(b, 2, 2);
+		put_bits(b, x >> b->trailing,
+			 64 - b->leading - b->trailing);
+		return;
+	}
+	put_bits(b, 3, 2);
+	put_bits(b, leading, 5);
+	put_bits(b, 64 - leading - trailing - 1, 6);
+	put_bits(b, x >> trailing, 64 - leading - trailing);
+	b->leading = leading;
+	b->trailing = trailing;
+}
+
+static uint64_t get_value(struct bit_reader *r, uint64_t *value,
+			  int *leading, int *trailing)
+{
+	int len;
+
+	if (!get_bits(r, 1))
+		return *value;
+	if (get_bits(r, 1)) {
+		*leading = get_bits(r, 5);
+		len = get_bits(r, 6) + 1;
+		*trailing = 64 - *leading - len;
+	}
+	len = 64 - *leading - *trailing;
+	return *value ^= get_bits(r, len) << *trailing;
+}
+
+static void append(struct hist_block *b, int64_t ts, double value)
+{
+	if (b->count == 0) {
+		b->first_ts = b->last_ts = ts;
+		b->first_value = b->last_value = double_bits(value);
+	} else {
+		put_timestamp(b, ts);
+		put_value(b, double_bits(value));
+	}
+	b->count++;
+}
+
+static void hist_init(struct hist_file *f)
+{
+	int i;
+
+	memset(f->h, 0, f->size);
+	f->h->magic = HIST_MAGIC;
+	f->h->version = HIST_VERSION;
+	f->h->nb_blocks = HIST_BLOCKS;
+	for (i = 0; i < HIST_FIELDS; i++)
+		f->h->current[i] = -1;
+	for (i = 0; i < HIST_BLOCKS; i++)
+		f->blocks[i].field = HIST_FREE;
+}
+
+/* Map the history of plugin, creating it when create is set. The file is
+ * locked until hist_close(). */
+static int hist_open(struct hist_file *f, const char *dir,
+		     const char *plugin, int create)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/%s.hist", dir, plugin);
+	f->size = sizeof(struct hist_header)
+	    + HIST_BLOCKS * sizeof(struct hist_block);
+	f->fd = open(path, (create ? O_RDWR | O_CREAT : O_RDONLY)
+		     | O_CLOEXEC, 0644);
+	if (f->fd < 0)
+		return -1;
+	if (flock(f->fd, create ? LOCK_EX : LOCK_SH) < 0
+	    || fstat(f->fd, &st) < 0)
+		goto error;
+	if ((size_t) st.st_size != f->size) {
+		if (!create || ftruncate(f->fd, f->size) < 0)
+			goto error;
+	}
+	f->h = mmap(NULL, f->size, create ? PROT_READ | PROT_WRITE :
+		    PROT_READ, MAP_SHARED, f->fd, 0);
+	if (f->h == MAP_FAILED)
+		goto error;
+	f->blocks = (struct hist_block *) (f->h + 1);
+	if (f->h->magic != HIST_MAGIC || f->h->version != HIST_VERSION
+	    || f->h->nb_blocks != HIST_BLOCKS) {
+		if (!create) {
+			munmap(f->h, f->size);
+			goto error;
+		}
+		/* New, or from another version: start over */
+		hist_init(f);
+	}
+	return 0;
+
+      error:
+	close(f->fd);
+	return -1;
+}
+
+static void hist_close(struct hist_file *f)
+{
+	munmap(f->h, f->size);
+	close(f->fd);
+}
+
+static int field_index(struct hist_header *h, const char *name)
+{
+	int i;
+
+	if (strlen(name) >= HIST_NAME_SIZE)
+		return -1;
+	for (i = 0; i < HIST_FIELDS && h->names[i][0]; i++)
+		if (!strcmp(h->names[i], name))
+			return i;
+	if (i == HIST_FIELDS)
+		return -1;
+	strcpy(h->names[i], name);
+	return i;
+}
+
+static struct hist_block *new_block(struct hist_file *f, int field)
+{
+	uint32_t i = f->h->head;
+	struct hist_block *b = f->blocks + i;
+
+	f->h->head = (i + 1) % f->h->nb_blocks;
+	if (b->field != HIST_FREE && f->h->current[b->field] == (int32_t) i)
+		f->h->current[b->field] = -1;
+	memset(b, 0, sizeof(*b));
+	b->field = field;
+	b->leading = 0xff;
+	f->h->current[field] = i;
+	return b;
+}
+
+static void record(struct hist_file *f, const char *name, int64_t ts,
+		   double value)
+{
+	struct hist_block *b = NULL;
+	int field;
+
+	if ((field = field_index(f->h, name)) < 0)
+		return;
+	if (f->h->current[field] >= 0) {
+		b = f->blocks + f->h->current[field];
+		if (ts <= b->last_ts)
+			return;	/* already known */
+		if ((size_t) b->nbits + HIST_SAMPLE_MAX_BITS
+		    > sizeof(b->data) * 8)
+			b = NULL;
+	}
+	if (!b)
+		b = new_block(f, field);
+	append(b, ts, value);
+}
+
+int history_record(const char *dir, const char *plugin, const char *output,
+		   time_t now)
+{
+	char graph[HIST_NAME_SIZE] = "", line[512], name[HIST_NAME_SIZE * 2];
+	struct hist_file f;
+	const char *s, *next;
+
+	if (hist_open(&f, dir, plugin, 1) < 0)
+		return -1;
+
+	for (s = output; *s; s = next) {
+		char *dot, *value, *colon;
+		int64_t ts = now;
+		size_t len;
+		double v;
+
+		next = s + strcspn(s, "\n");
+		len = next - s;
+		if (*next)
+			next++;
+		if (len >= sizeof(line))
+			continue;
+		memcpy(line, s, len);
+		line[len] = '\0';
+
+		if (!strncmp(line, "multigraph ", 11)) {
+			/* The plugin's own graph gets plain names */
+			if (!strcmp(line + 11, plugin))
+				graph[0] = '\0';
+			else
+				snprintf(graph, sizeof(graph), "%s",
+					 line + 11);
+			continue;
+		}
+		if (!(value = strchr(line, ' ')))
+			continue;
+		*value++ = '\0';
+		if (!(dot = strstr(line, ".value")) || dot[6])
+			continue;
+		*dot = '\0';
+
+		if ((colon = strchr(value, ':'))) {
+			ts = strtoll(value, NULL, 10);
+			value = colon + 1;
+		}
+		v = strcmp(value, "U") ? strtod(value, NULL) : NAN;
+		snprintf(name, sizeof(name), "%s%s%s", graph,
+			 graph[0] ? "." : "", line);
+		record(&f, name, ts, v);
+	}
+
+	hist_close(&f);
+	return 0;
+}
+
+static void print_value(const char *name, int64_t ts, double v)
+{
+	if (isnan(v))
+		printf("%s.value %lld:U\n", name, (long long) ts);
+	else if (v == (int64_t) v && fabs(v) < 9007199254740992.0)
+		printf("%s.value %lld:%.0f\n", name, (long long) ts, v);
+	else
+		printf("%s.value %lld:%.17g\n", name, (long long) ts, v);
+}
+
+static void dump_block(const struct hist_block *b, const char *name,
+		       time_t since)
+{
+	struct bit_reader r = { b->data, 0, b->nbits };
+	uint64_t value = b->first_value;
+	int64_t ts = b->first_ts, delta = 0;
+	int leading = 0, trailing = 0, i;
+
+	if (ts > since)
+		print_value(name, ts, bits_double(value));
+	for (i = 1; i < b->count; i++) {
+		ts += get_timestamp(&r, &delta);
+		get_value(&r, &value, &leading, &trailing);
+		if (ts > since)
+			print_value(name, ts, bits_double(value));
+	}
+}
+
+int history_dump(const char *dir, const char *plugin, time_t since)
+{
+	char graph[HIST_NAME_SIZE] = "";
+	struct hist_file f;
+	uint32_t i, n;
+	int field;
+
+	if (hist_open(&f, dir, plugin, 0) < 0)
+		return -1;
+
+	for (field = 0; field < HIST_FIELDS && f.h->names[field][0];
+	     field++) {
+		const char *name = f.h->names[field], *dot;
+		size_t graph_len;
+
+		/* Go back to the plugin's graph for plain names. Graph
+		 * names can have dots, field names cannot. */
+		dot = strrchr(name, '.');
+		graph_len = dot ? (size_t) (dot - name) : 0;
+		if (strlen(graph) != graph_len
+		    || strncmp(graph, name, graph_len)) {
+			snprintf(graph, sizeof(graph), "%.*s",
+				 (int) graph_len, name);
+			printf("multigraph %s\n", graph_len ? graph : plugin);
+		}
+
+		/* Oldest first */
+		for (n = 0, i = f.h->head; n < f.h->nb_blocks;
+		     n++, i = (i + 1) % f.h->nb_blocks)
+			if (f.blocks[i].field == field)
+				dump_block(f.blocks + i,
+					   dot ? dot + 1 : name, since);
+	}
+
+	hist_close(&f);
+	return 0;
+}
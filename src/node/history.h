@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <time.h>
+
+/** The history of a plugin is a fixed size file, <dir>/<plugin>.hist,
+ * mapped in memory. It is a ring of small blocks, each holding a run of
+ * samples of a single field: the timestamps are stored as delta of deltas
+ * and the values as the XOR with the previous one, as done by Gorilla, so
+ * that a sample of a steady field costs a few bits. When the ring is full
+ * the oldest block is reused, whatever field it belongs to. A file takes
+ * about 150 kB, enough for days of 5 minute samples of a few dozen fields.
+ *
+ * Fields of multigraph plugins are stored as "graph.field". */
+
+/** Record the values of a fetch output, "field.value [timestamp:]value"
+ * lines with optional "multigraph" lines, at the given time.
+ * @returns 0 on success, -1 on error */
+int history_record(const char *dir, const char *plugin, const char *output,
+		   time_t now);
+
+/** Print the samples stored for plugin strictly after since, field by
+ * field and oldest first, as "field.value timestamp:value" lines preceded
+ * by "multigraph" lines when needed.
+ * @returns 0 on success, -1 if there is no history for the plugin */
+int history_dump(const char *dir, const char *plugin, time_t since);
+
+#endif
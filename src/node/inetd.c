@@ -18,6 +18,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <signal.h>
+#include "../probes.h"
 
 #if !(defined(HAVE_WORKING_VFORK) || defined(S_SPLINT_S))
 #define vfork fork
@@ -73,7 +74,7 @@ int main(int argc, char *argv[])
 		close(sock_listen);
 		return 1;
 	}
-	if (listen(sock_listen, 5) != 0) {
+	if (listen(sock_listen, SOMAXCONN) != 0) {
 		perror("failed to listen on the socket");
 		close(sock_listen);
 		return 1;
@@ -83,6 +84,7 @@ int main(int argc, char *argv[])
 	signal(SIGCHLD, SIG_IGN);
 
 	while ((sock_accept = accept(sock_listen, NULL, NULL)) != -1) {
+		PROBE1(connection__accept, sock_accept);
 		if (0 == (pid = vfork())) {
 			/* we are in the child */
 			close(sock_listen);
@@ -26,6 +26,19 @@
 #include <grp.h>
 #include <fnmatch.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include "alerts.h"
+#include "binenc.h"
+#include "history.h"
+#include "plugindef.h"
+#include "spool.h"
+#include "../probes.h"
 
 #ifndef HOST_NAME_MAX
 #define HOST_NAME_MAX 256
@@ -43,12 +56,22 @@ static const int no = 0;
 static int is_acquire = 0;
 static int verbose = 0;
 static bool extension_stripping = false;
+static bool use_zygotes = false;
 
 static char *host = "";
 static char *plugin_dir = PLUGINDIR;
 static char *spoolfetch_dir = "";
 static char *client_ip = "-";
 static char *pluginconf_dir = PLUGINCONFDIR;
+static char *plugindef_dir = PLUGINDEFDIR;
+static char *history_dir = "";
+static char *cache_dir = "";
+
+/* Set once the master announced it, with the fields it was sent */
+static bool binary = false;
+static struct binenc dictionary;
+static long spool_max_age = 0;
+static long spool_max_size = 0;
 
 static int handle_connection();
 
@@ -164,7 +187,7 @@ int main(int argc, char *argv[])
 
 	int optch;
 
-	char format[] = "aevd:D:H:s:";
+	char format[] = "aevzA:C:d:D:H:P:R:s:Z:";
 
 	struct sockaddr_in client;
 
@@ -183,6 +206,9 @@ int main(int argc, char *argv[])
 		case 'v':
 			verbose++;
 			break;
+		case 'z':
+			use_zygotes = true;
+			break;
 		case 'd':
 			plugin_dir = xstrdup(optarg);
 			break;
@@ -192,9 +218,24 @@ int main(int argc, char *argv[])
 		case 'H':
 			host = xstrdup(optarg);
 			break;
+		case 'P':
+			plugindef_dir = xstrdup(optarg);
+			break;
+		case 'R':
+			history_dir = xstrdup(optarg);
+			break;
 		case 's':
 			spoolfetch_dir = xstrdup(optarg);
 			break;
+		case 'C':
+			cache_dir = xstrdup(optarg);
+			break;
+		case 'A':
+			spool_max_age = atol(optarg);
+			break;
+		case 'Z':
+			spool_max_size = atol(optarg);
+			break;
 		}
 
 	/* get default hostname if not precised */
@@ -256,7 +297,8 @@ static void setenvvars_munin()
 
 	/* We only have one user, so using a fixed path */
 	xsetenv("MUNIN_PLUGSTATE", "/var/tmp", no);
-	xsetenv("MUNIN_STATEFILE", "/dev/null", no);
+	if ('\0' != *spoolfetch_dir)
+		xsetenv("MUNIN_SPOOLDIR", spoolfetch_dir, no);
 
 	/* That's where plugins should live */
 	xsetenv("MUNIN_LIBDIR", "/usr/share/munin", no);
@@ -482,18 +524,74 @@ static struct s_plugin_conf *parse_plugin_conf(FILE * f,
 	return conf;
 }
 
-/* Setting user configured vars */
-static void setenvvars_conf(char *current_plugin_name)
+/* The plugin-conf.d files, read once per session when using zygotes */
+static int nb_conf_files;
+static char **conf_files;
+
+static void load_conf_files()
 {
-	struct s_plugin_conf pconf;
-	pconf.size = 0;
-	pconf.used = 0;
-	pconf.env = NULL;
+	DIR *dirp = opendir(pluginconf_dir);
+	struct dirent *dp;
+
+	if (dirp == NULL)
+		return;
+	while ((dp = readdir(dirp)) != NULL) {
+		char path[LINE_MAX], *buf = NULL;
+		size_t size = 0;
+		FILE *f, *mem;
+
+		if (dp->d_name[0] == '.')
+			continue;
+		snprintf(path, LINE_MAX, "%s/%s", pluginconf_dir,
+			 dp->d_name);
+		if ((f = fopen(path, "r")) == NULL)
+			continue;
+		if ((mem = open_memstream(&buf, &size)) == NULL)
+			oom_handler();
+		{
+			char chunk[4096];
+			size_t n;
+			while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+				fwrite(chunk, 1, n, mem);
+		}
+		fclose(f);
+		fclose(mem);
+
+		conf_files = realloc(conf_files,
+				     sizeof(char *) * (nb_conf_files + 1));
+		if (conf_files == NULL)
+			oom_handler();
+		conf_files[nb_conf_files++] = buf;
+	}
+	closedir(dirp);
+}
+
+/* Gather the conf of a plugin, from memory when the files were loaded */
+static void read_plugin_conf(const char *current_plugin_name,
+			     struct s_plugin_conf *pconf)
+{
+	PROBE1(conf__parse__start, current_plugin_name);
+	pconf->size = 0;
+	pconf->used = 0;
+	pconf->env = NULL;
 	/* default is nobody:nogroup */
-	strcpy(pconf.user, "nobody");
-	strcpy(pconf.group, "nogroup");
+	strcpy(pconf->user, "nobody");
+	strcpy(pconf->group, "nogroup");
+
+	if (conf_files != NULL) {
+		int i;
+		for (i = 0; i < nb_conf_files; i++) {
+			FILE *f = fmemopen(conf_files[i],
+					   strlen(conf_files[i]), "r");
+			if (f == NULL)
+				continue;
+			parse_plugin_conf(f, current_plugin_name, pconf);
+			fclose(f);
+		}
+		PROBE1(conf__parse__end, current_plugin_name);
+		return;
+	}
 
-	/* TODO - add plugin conf parsing */
 	DIR *dirp = opendir(pluginconf_dir);
 	if (dirp == NULL) {
 		printf("# Cannot open plugin config dir '%s'\n",
@@ -520,7 +618,7 @@ static void setenvvars_conf(char *current_plugin_name)
 
 				parse_plugin_conf(f,
 						  current_plugin_name,
-						  &pconf);
+						  pconf);
 
 				fclose(f);
 			}
@@ -528,17 +626,18 @@ static void setenvvars_conf(char *current_plugin_name)
 
 		closedir(dirp);
 	}
+	PROBE1(conf__parse__end, current_plugin_name);
+}
 
-	/* Set env after whole parsing */
-	{
-		size_t i;
-		for (i = 0; i < pconf.used; i++) {
-			struct s_env *env = pconf.env + i;
-			putenv(env->buffer);
-		}
-		/* Cannot free pconf.env array because putenv() keeps references to it */
-	}
+/* One state per plugin and master, as munin-node does */
+static void statefile_name(char *statefile, const char *plugin)
+{
+	snprintf(statefile, LINE_MAX, "%s/%s-%s",
+		 getenv("MUNIN_PLUGSTATE"), plugin, client_ip);
+}
 
+static void drop_privileges(const char *user, const char *group)
+{
 	/* setuid/gid */
 	if (geteuid() == 0) {
 		/* We *are* root */
@@ -546,12 +645,12 @@ static void setenvvars_conf(char *current_plugin_name)
 		struct group *grp;
 		struct passwd *pswd;
 
-		pswd = getpwnam(pconf.user);
+		pswd = getpwnam(user);
 		if (pswd == NULL) {
 			perror("getpwnam() error");
 			abort();
 		}
-		grp = getgrnam(pconf.group);
+		grp = getgrnam(group);
 		if (grp == NULL) {
 			perror("getgrnam() error");
 			abort();
@@ -574,13 +673,539 @@ static void setenvvars_conf(char *current_plugin_name)
 	}
 }
 
+/* Setting user configured vars */
+static void setenvvars_conf(char *current_plugin_name)
+{
+	struct s_plugin_conf pconf;
+	char statefile[LINE_MAX];
+
+	read_plugin_conf(current_plugin_name, &pconf);
+
+	/* Set env after whole parsing */
+	{
+		size_t i;
+		for (i = 0; i < pconf.used; i++) {
+			struct s_env *env = pconf.env + i;
+			putenv(env->buffer);
+		}
+		/* Cannot free pconf.env array because putenv() keeps references to it */
+	}
+
+	statefile_name(statefile, current_plugin_name);
+	xsetenv("MUNIN_STATEFILE", statefile, no);
+
+	drop_privileges(pconf.user, pconf.group);
+}
+
+/* Zygotes are processes forked ahead, one per user and group plugins run
+ * as, that already dropped their privileges and wait on a socket for the
+ * plugin to exec, its environment and the fd of its output. A zygote is
+ * used once, and replaced after the answer is sent. */
+#define MAX_ZYGOTES 16
+#define ZYGOTE_MSG_SIZE (MAX_ENV_NB * MAX_ENV_BUF_SZ + 4 * LINE_MAX)
+
+struct zygote {
+	char user[MAX_ENV_BUF_SZ];
+	char group[MAX_ENV_BUF_SZ];
+	pid_t pid;		/* 0 once used */
+	int sock;
+};
+
+static int nb_zygotes;
+static struct zygote zygotes[MAX_ZYGOTES];
+
+/* Wait for a plugin to exec, as "cmdline\0arg\0cmd\0env\0..." */
+static /*@noreturn@ */ void zygote_main(int sock)
+{
+	static char msg[ZYGOTE_MSG_SIZE];
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov = { msg, sizeof(msg) - 1 };
+	struct msghdr mh;
+	struct cmsghdr *cm;
+	char *cmdline, *arg, *cmd, *s;
+	int fd = -1;
+	ssize_t n;
+
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = control;
+	mh.msg_controllen = sizeof(control);
+	do {
+		n = recvmsg(sock, &mh, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0)
+		_exit(0);	/* the session is over */
+	msg[n] = '\0';
+	cm = CMSG_FIRSTHDR(&mh);
+	if (cm != NULL && cm->cmsg_type == SCM_RIGHTS)
+		memcpy(&fd, CMSG_DATA(cm), sizeof(fd));
+	if (fd < 0)
+		_exit(EXIT_FAILURE);
+	close(sock);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+
+	cmdline = msg;
+	arg = cmdline + strlen(cmdline) + 1;
+	cmd = arg + strlen(arg) + 1;
+	for (s = cmd + strlen(cmd) + 1; s < msg + n; s += strlen(s) + 1)
+		putenv(s);
+	PROBE2(plugin__exec, cmdline, arg);
+	execl(cmdline, arg, *cmd ? cmd : NULL, NULL);
+
+	// If we are here the execl() failed, bailing out with an error
+	printf("# execl failed\n");
+	exit(EXIT_FAILURE);
+}
+
+/* Plugins read /dev/null: the client may have sent its next commands
+ * already, and those are for the node */
+static void detach_stdin()
+{
+	int fd = open("/dev/null", O_RDONLY);
+
+	if (fd > STDIN_FILENO) {
+		dup2(fd, STDIN_FILENO);
+		close(fd);
+	}
+}
+
+static void spawn_zygote(struct zygote *z)
+{
+	int sv[2], i;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+		return;
+	fflush(stdout);
+	z->pid = fork();
+	if (z->pid == -1) {
+		z->pid = 0;
+		close(sv[0]);
+		close(sv[1]);
+		return;
+	} else if (z->pid == 0) {
+		/* Only the node may talk to the other zygotes */
+		for (i = 0; i < nb_zygotes; i++)
+			if (zygotes[i].pid > 0)
+				close(zygotes[i].sock);
+		close(sv[0]);
+		detach_stdin();
+		drop_privileges(z->user, z->group);
+		zygote_main(sv[1]);
+	}
+	PROBE1(zygote__fork, z->pid);
+	close(sv[1]);
+	z->sock = sv[0];
+}
+
+/* One zygote for each user and group found for the plugins */
+static void start_zygotes()
+{
+	DIR *dirp;
+	struct dirent *dp;
+	int i;
+
+	load_conf_files();
+	if ((dirp = opendir(plugin_dir)) == NULL)
+		return;
+	while ((dp = readdir(dirp)) != NULL && nb_zygotes < MAX_ZYGOTES) {
+		struct s_plugin_conf pconf;
+
+		if (dp->d_name[0] == '.')
+			continue;
+		read_plugin_conf(dp->d_name, &pconf);
+		free(pconf.env);
+		for (i = 0; i < nb_zygotes; i++)
+			if (!strcmp(zygotes[i].user, pconf.user)
+			    && !strcmp(zygotes[i].group, pconf.group))
+				break;
+		if (i < nb_zygotes)
+			continue;
+		strcpy(zygotes[nb_zygotes].user, pconf.user);
+		strcpy(zygotes[nb_zygotes].group, pconf.group);
+		nb_zygotes++;
+	}
+	closedir(dirp);
+
+	for (i = 0; i < nb_zygotes; i++)
+		spawn_zygote(zygotes + i);
+}
+
+/* Replace the zygotes used, once the client has its answer */
+static void refill_zygotes()
+{
+	int i;
+
+	for (i = 0; i < nb_zygotes; i++)
+		if (zygotes[i].pid == 0)
+			spawn_zygote(zygotes + i);
+}
+
+/* Have a zygote exec a plugin, writing to fd.
+ * @returns the pid of the plugin, or -1 when no zygote can run it */
+static pid_t zygote_exec(const char *cmdline, const char *arg,
+			 const char *cmd, int fd)
+{
+	static char msg[ZYGOTE_MSG_SIZE];
+	char control[CMSG_SPACE(sizeof(int))];
+	struct s_plugin_conf pconf;
+	struct zygote *z = NULL;
+	struct iovec iov;
+	struct msghdr mh;
+	struct cmsghdr *cm;
+	bool has_statefile = false;
+	size_t len = 0, i;
+	pid_t pid;
+	int n;
+
+	if (!use_zygotes)
+		return -1;
+	read_plugin_conf(arg, &pconf);
+	for (i = 0; i < (size_t) nb_zygotes; i++)
+		if (zygotes[i].pid > 0
+		    && !strcmp(zygotes[i].user, pconf.user)
+		    && !strcmp(zygotes[i].group, pconf.group))
+			z = zygotes + i;
+	if (z == NULL) {
+		free(pconf.env);
+		return -1;
+	}
+
+#ifdef LEGACY_FETCH
+	/* The munin-node implementation does not set arg[1] if "fetch" */
+	if (strcmp(cmd, "fetch") == 0) {
+		cmd = "";
+	}
+#endif				// LEGACY_FETCH
+	n = snprintf(msg, sizeof(msg), "%s%c%s%c%s%c", cmdline, 0, arg, 0,
+		     cmd, 0);
+	len = n;
+	for (i = 0; i < pconf.used; i++) {
+		struct s_env *env = pconf.env + i;
+		if (env->key_len == strlen("MUNIN_STATEFILE")
+		    && !strncmp(env->buffer, "MUNIN_STATEFILE=",
+				env->key_len + 1))
+			has_statefile = true;
+		len += snprintf(msg + len, sizeof(msg) - len, "%s%c",
+				env->buffer, 0);
+	}
+	free(pconf.env);
+	if (!has_statefile) {
+		char statefile[LINE_MAX];
+		statefile_name(statefile, arg);
+		len += snprintf(msg + len, sizeof(msg) - len,
+				"MUNIN_STATEFILE=%s%c", statefile, 0);
+	}
+	if (len >= sizeof(msg))
+		return -1;
+
+	iov.iov_base = msg;
+	iov.iov_len = len;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = control;
+	mh.msg_controllen = sizeof(control);
+	cm = CMSG_FIRSTHDR(&mh);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+
+	pid = z->pid;
+	z->pid = 0;
+	if (sendmsg(z->sock, &mh, MSG_NOSIGNAL) < 0) {
+		/* Dead, it is not given another chance */
+		close(z->sock);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return -1;
+	}
+	close(z->sock);
+	return pid;
+}
+
+/* FNV-1a of a config output, fed as it is read */
+#define CONFIG_HASH_INIT UINT64_C(14695981039346656037)
+
+static uint64_t config_hash(uint64_t h, const char *data, size_t len)
+{
+	for (; len; data++, len--)
+		h = (h ^ (unsigned char) *data) * UINT64_C(1099511628211);
+	return h;
+}
+
+/* Run a plugin, copying its whole output to copy unless it is NULL.
+ * When capture is not NULL the output is also kept there, NUL terminated,
+ * up to the last complete line that fits in size. When hash is not NULL
+ * the whole output is hashed into it. */
+static void run_plugin(const char *cmdline, char *arg, char *cmd, FILE *copy,
+		       char *capture, size_t size, uint64_t *hash)
+{
+	char buf[4096];
+	size_t used = 0;
+	bool full = false, first = true;
+	ssize_t n;
+	int fds[2], status = 0;
+	pid_t pid;
+
+	if (pipe(fds) < 0) {
+		printf("# pipe failed\n");
+		return;
+	}
+
+	/* A zygote only has to exec. Otherwise using fork() here instead
+	 * of vork() since we will do a little more than a mere exec -->
+	 * setenvvars_conf() */
+	pid = zygote_exec(cmdline, arg, cmd, fds[1]);
+	if (pid < 0)
+		pid = fork();
+
+	if (pid == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		printf("# fork failed\n");
+		return;
+	} else if (pid == 0) {
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[1]);
+		detach_stdin();
+
+		/* Now is the time to set environnement */
+		setenvvars_conf(arg);
+#ifdef LEGACY_FETCH
+		/* The munin-node implementation does not set arg[1] if "fetch" */
+		if (strcmp(cmd, "fetch") == 0) {
+			cmd = NULL;
+		}
+#endif				// LEGACY_FETCH
+		PROBE2(plugin__exec, cmdline, arg);
+		execl(cmdline, arg, cmd, NULL);
+
+		// If we are here the execl() failed, bailing out with an error
+		printf("# execl failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	PROBE2(plugin__fork, arg, pid);
+	close(fds[1]);
+	while ((n = read(fds[0], buf, sizeof(buf))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (first)
+			PROBE2(plugin__output, arg, n);
+		first = false;
+		if (copy)
+			fwrite(buf, 1, n, copy);
+		if (hash)
+			*hash = config_hash(*hash, buf, n);
+		if (capture == NULL || full)
+			continue;
+		if (used + n < size) {
+			memcpy(capture + used, buf, n);
+			used += n;
+			continue;
+		}
+		/* Keep what fits, without a partial line */
+		memcpy(capture + used, buf, size - 1 - used);
+		capture[size - 1] = '\0';
+		used = strrchr(capture, '\n') ?
+		    (size_t) (strrchr(capture, '\n') - capture) + 1 : 0;
+		full = true;
+	}
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+	PROBE3(plugin__reap, arg, pid, status);
+
+	if (capture != NULL)
+		capture[used] = '\0';
+}
+
+/* The path of the executable answering for a plugin */
+static void plugin_path(char *cmdline, const char *arg)
+{
+	if (!extension_stripping
+	    || find_plugin_with_basename(cmdline, plugin_dir, arg) == 0) {
+		/* extension_stripping failed, using the plain method */
+		snprintf(cmdline, LINE_MAX, "%s/%s", plugin_dir, arg);
+	}
+}
+
+/* Executables answer before the definitions of the same name */
+static int is_executable_plugin(const char *name)
+{
+	char cmdline[LINE_MAX];
+
+	plugin_path(cmdline, name);
+	return access(cmdline, X_OK) == 0;
+}
+
+/* Write the plugins, each followed by a space, as the list command does */
+static int list_plugins(FILE *out)
+{
+	DIR *dirp = opendir(plugin_dir);
+	if (dirp == NULL)
+		return -1;
+	{
+		struct dirent *dp;
+		while ((dp = readdir(dirp)) != NULL) {
+			char cmdline[LINE_MAX];
+			char *plugin_filename = dp->d_name;;
+
+			if (plugin_filename[0] == '.') {
+				/* No dotted plugin */
+				continue;
+			}
+
+			snprintf(cmdline, LINE_MAX, "%s/%s", plugin_dir,
+				 plugin_filename);
+			if (access(cmdline, X_OK) == 0) {
+				if (extension_stripping) {
+					/* Strip after the last . */
+					char *last_dot_idx =
+					    strrchr(plugin_filename, '.');
+					if (last_dot_idx != NULL) {
+						*last_dot_idx = '\0';
+					}
+				}
+				fprintf(out, "%s ", plugin_filename);
+			}
+		}
+		closedir(dirp);
+	}
+	plugindef_list(plugindef_dir, is_executable_plugin, out);
+	return 0;
+}
+
+/* Config versions are kept in the cache directory this long, or until the
+ * plugin changes */
+#define CONFIG_VERSION_TTL 300
+
+static void save_config_version(const char *plugin, uint64_t hash)
+{
+	char path[LINE_MAX], tmp[LINE_MAX + 4];
+	FILE *f;
+
+	if ('\0' == *cache_dir)
+		return;
+	snprintf(path, LINE_MAX, "%s/%s.configversion", cache_dir, plugin);
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((f = fopen(tmp, "w")) == NULL)
+		return;
+	fprintf(f, "%016" PRIx64 "\n", hash);
+	if (fclose(f) != 0 || rename(tmp, path) != 0)
+		unlink(tmp);
+}
+
+/* The last change to the plugin-conf.d directory or its files, which set
+ * the environment, and so the config, of any plugin */
+static time_t pluginconf_mtime(void)
+{
+	DIR *dirp = opendir(pluginconf_dir);
+	struct dirent *dp;
+	struct stat st;
+	time_t mtime = 0;
+
+	if (dirp == NULL)
+		return 0;
+	if (fstat(dirfd(dirp), &st) == 0)
+		mtime = st.st_mtime;
+	while ((dp = readdir(dirp)) != NULL) {
+		if (dp->d_name[0] == '.')
+			continue;
+		if (fstatat(dirfd(dirp), dp->d_name, &st, 0) == 0
+		    && st.st_mtime > mtime)
+			mtime = st.st_mtime;
+	}
+	closedir(dirp);
+	return mtime;
+}
+
+static bool load_config_version(const char *plugin, const char *path,
+				time_t now, time_t conf_mtime, char *version)
+{
+	char cached[LINE_MAX];
+	struct stat cache_st, st;
+	bool found;
+	FILE *f;
+
+	if ('\0' == *cache_dir)
+		return false;
+	snprintf(cached, LINE_MAX, "%s/%s.configversion", cache_dir, plugin);
+	/* File times may be a tick ahead of time() */
+	if (stat(cached, &cache_st) < 0
+	    || cache_st.st_mtime < now - CONFIG_VERSION_TTL
+	    || cache_st.st_mtime > now + 1)
+		return false;
+	if ((stat(path, &st) == 0 && st.st_mtime > cache_st.st_mtime)
+	    || conf_mtime > cache_st.st_mtime)
+		return false;
+	if ((f = fopen(cached, "r")) == NULL)
+		return false;
+	found = fscanf(f, "%16s", version) == 1 && strlen(version) == 16;
+	fclose(f);
+	return found;
+}
+
+/* The hash of the config output of a plugin, from the cache or by
+ * running it, conf_mtime being the one of pluginconf_mtime().
+ * @returns 0 on success, -1 if there is no such plugin */
+static int config_version(char *plugin, time_t now, time_t conf_mtime,
+			  char *version)
+{
+	static char output[65536];
+	char cmdline[LINE_MAX], config[] = "config";
+	uint64_t hash = CONFIG_HASH_INIT;
+
+	plugin_path(cmdline, plugin);
+	if (access(cmdline, X_OK) == 0) {
+		if (load_config_version(plugin, cmdline, now, conf_mtime,
+					version))
+			return 0;
+		run_plugin(cmdline, plugin, config, NULL, output,
+			   sizeof(output), &hash);
+	} else if (plugindef_exists(plugindef_dir, plugin)) {
+		char *buf = NULL;
+		size_t size = 0;
+		FILE *f;
+
+		snprintf(cmdline, LINE_MAX, "%s/%s", plugindef_dir, plugin);
+		if (load_config_version(plugin, cmdline, now, conf_mtime,
+					version))
+			return 0;
+		if ((f = open_memstream(&buf, &size)) == NULL)
+			oom_handler();
+		plugindef_run(plugindef_dir, plugin, config, f);
+		fclose(f);
+		hash = config_hash(hash, buf, size);
+		snprintf(output, sizeof(output), "%s", buf);
+		free(buf);
+	} else {
+		return -1;
+	}
+
+	snprintf(version, 17, "%016" PRIx64, hash);
+	save_config_version(plugin, hash);
+	if ('\0' != *cache_dir)
+		alerts_config(cache_dir, plugin, output);
+	return 0;
+}
+
 static int handle_connection()
 {
 	char line[LINE_MAX];
 
 	/* Prepare per connection plugin env vars */
 	setenvvars_munin();
+	if (use_zygotes)
+		start_zygotes();
 
+	PROBE1(connection__start, client_ip);
 	printf("# munin node at %s\n", host);
 	while (fflush(stdout), fgets(line, LINE_MAX, stdin) != NULL) {
 		char *cmd;
@@ -591,6 +1216,7 @@ static int handle_connection()
 			arg = NULL;
 		else
 			arg = strtok(NULL, " \t\n\r");
+		PROBE2(command__parse, cmd, arg);
 
 		if (!cmd || strlen(cmd) == 0) {
 			printf("# empty cmd\n");
@@ -602,110 +1228,164 @@ static int handle_connection()
 		} else if (strcmp(cmd, "quit") == 0) {
 			return (0);
 		} else if (strcmp(cmd, "list") == 0) {
-			DIR *dirp = opendir(plugin_dir);
-			if (dirp == NULL) {
+			if (list_plugins(stdout) < 0) {
 				printf("# Cannot open plugin dir\n");
 				return (0);
 			}
-			{
-				struct dirent *dp;
-				while ((dp = readdir(dirp)) != NULL) {
-					char cmdline[LINE_MAX];
-					char *plugin_filename =
-					    dp->d_name;;
-
-					if (plugin_filename[0] == '.') {
-						/* No dotted plugin */
-						continue;
-					}
-
-					snprintf(cmdline, LINE_MAX,
-						 "%s/%s", plugin_dir,
-						 plugin_filename);
-					if (access(cmdline, X_OK) == 0) {
-						if (extension_stripping) {
-							/* Strip after the last . */
-							char *last_dot_idx
-							    =
-							    strrchr
-							    (plugin_filename,
-							     '.');
-							if (last_dot_idx !=
-							    NULL) {
-								*last_dot_idx
-								    = '\0';
-							}
-						}
-						printf("%s ",
-						       plugin_filename);
-					}
-				}
-				closedir(dirp);
-			}
 			putchar('\n');
+		} else if (strcmp(cmd, "configversions") == 0) {
+			char *names = NULL, *name, *save;
+			size_t size = 0;
+			time_t now = time(NULL), conf_mtime;
+			FILE *f = open_memstream(&names, &size);
+			if (f == NULL)
+				oom_handler();
+			list_plugins(f);
+			fclose(f);
+			conf_mtime = '\0' != *cache_dir ?
+			    pluginconf_mtime() : 0;
+			for (name = strtok_r(names, " ", &save); name != NULL;
+			     name = strtok_r(NULL, " ", &save)) {
+				char version[17];
+				if (config_version(name, now, conf_mtime,
+						   version) == 0)
+					printf("%s %s\n", name, version);
+			}
+			free(names);
+			printf(".\n");
 		} else if (strcmp(cmd, "config") == 0 ||
 			   strcmp(cmd, "fetch") == 0) {
-			char cmdline[LINE_MAX];
-			pid_t pid;
+			static char output[65536];
+			char cmdline[LINE_MAX], *encoded = NULL;
+			size_t encoded_size = 0;
+			uint64_t hash = CONFIG_HASH_INIT;
+			FILE *out = stdout;
+			bool fetch = strcmp(cmd, "fetch") == 0;
+			bool record = '\0' != *history_dir && fetch;
+			bool check = '\0' != *cache_dir;
+			time_t now = time(NULL);
 			if (arg == NULL) {
-				printf("# no plugin given\n");
+				printf("# no plugin given\n.\n");
 				continue;
 			}
 			if (arg[0] == '.' || strchr(arg, '/') != NULL) {
-				printf("# invalid plugin character\n");
+				printf("# invalid plugin character\n.\n");
 				continue;
 			}
-			if (!extension_stripping
-			    || find_plugin_with_basename(cmdline,
-							 plugin_dir,
-							 arg) == 0) {
-				/* extension_stripping failed, using the plain method */
-				snprintf(cmdline, LINE_MAX, "%s/%s",
-					 plugin_dir, arg);
-			}
+			plugin_path(cmdline, arg);
+			PROBE2(plugin__resolve, arg, cmdline);
+
+			/* The binary encoding needs the whole output, however
+			 * wide the plugin */
+			if (binary && (out = open_memstream(&encoded,
+							    &encoded_size))
+			    == NULL)
+				oom_handler();
 			if (access(cmdline, X_OK) == -1) {
-				printf("# unknown plugin: %s\n", arg);
+				int ret = -1;
+
+				/* Declarative plugins are evaluated here,
+				 * without forking */
+				if (plugindef_exists(plugindef_dir, arg))
+					ret = plugindef_run(plugindef_dir, arg,
+							    cmd, out);
+				if (binary)
+					fclose(out);
+				if (ret < 0) {
+					free(encoded);
+					printf("# unknown plugin: %s\n.\n", arg);
+					continue;
+				}
+				if (binary && fetch) {
+					binenc_fetch(&dictionary, encoded,
+						     stdout);
+				} else {
+					if (binary)
+						fputs(encoded, stdout);
+					printf(".\n");
+				}
+				if (binary && !fetch)
+					binenc_config(&dictionary, encoded,
+						      stdout);
+				free(encoded);
 				continue;
 			}
 
-			/* Using fork() here instead of vork() since we will
-			 * do a little more than a mere exec --> setenvvars_conf() */
-			pid = fork();
-
-			if (pid == -1) {
-				printf("# fork failed\n");
+			run_plugin(cmdline, arg, cmd, out,
+				   record || check ? output : NULL,
+				   sizeof(output),
+				   check && !fetch ? &hash : NULL);
+			if (binary)
+				fclose(out);
+
+			if (binary && fetch) {
+				binenc_fetch(&dictionary, encoded, stdout);
+			} else {
+				if (binary)
+					fputs(encoded, stdout);
+				/* We need to send the whole EOF string, since the plugin might not end itself with "\n" */
+				printf("\n.\n");
+			}
+			if (binary && !fetch)
+				binenc_config(&dictionary, encoded, stdout);
+			free(encoded);
+			if (check && !fetch)
+				save_config_version(arg, hash);
+
+			/* Recorded once the client has its answer */
+			fflush(stdout);
+			refill_zygotes();
+			if (record)
+				history_record(history_dir, arg, output, now);
+			if (check && fetch)
+				alerts_fetch(cache_dir, arg, output, now);
+			else if (check)
+				alerts_config(cache_dir, arg, output);
+		} else if (strcmp(cmd, "history") == 0) {
+			char *since = strtok(NULL, " \t\n\r");
+			if ('\0' == *history_dir) {
+				printf("# history is not enabled\n.\n");
 				continue;
-			} else if (pid == 0) {
-				/* Now is the time to set environnement */
-				setenvvars_conf(arg);
-#ifdef LEGACY_FETCH
-				/* The munin-node implementation does not set arg[1] if "fetch" */
-				if (strcmp(cmd, "fetch") == 0) {
-					cmd = NULL;
-				}
-#endif				// LEGACY_FETCH
-				execl(cmdline, arg, cmd, NULL);
-
-				// If we are here the execl() failed, bailing out with an error
-				printf("# execl failed\n");
-				exit(EXIT_FAILURE);
 			}
-
-			waitpid(pid, NULL, 0);
-
-			/* We need to send the whole EOF string, since the plugin might not end itself with "\n" */
-			printf("\n.\n");
+			if (arg == NULL) {
+				printf("# no plugin given\n.\n");
+				continue;
+			}
+			if (arg[0] == '.' || strchr(arg, '/') != NULL) {
+				printf("# invalid plugin character\n.\n");
+				continue;
+			}
+			if (history_dump(history_dir, arg,
+					 since ? strtoll(since, NULL,
+							 10) : 0) < 0) {
+				printf("# no history for %s\n", arg);
+			}
+			printf(".\n");
+		} else if (strcmp(cmd, "alerts") == 0) {
+			if ('\0' == *cache_dir) {
+				printf("# alerts are not enabled\n.\n");
+				continue;
+			}
+			alerts_list(cache_dir);
+			printf(".\n");
 		} else if (strcmp(cmd, "cap") == 0) {
-			printf("cap ");
+			/* The capabilities of the master */
+			for (; arg != NULL; arg = strtok(NULL, " \t\n\r"))
+				if (strcmp(arg, "binary") == 0)
+					binary = true;
+			printf("cap binary configversion pipelining ");
 			if ('\0' != *spoolfetch_dir) {
 				printf("spool ");
 			}
+			if ('\0' != *history_dir) {
+				printf("history ");
+			}
 			printf("\n");
 		} else if (strcmp(cmd, "spoolfetch") == 0) {
 			printf("# not implem yet cmd: %s\n", cmd);
 		} else {
 			printf
-			    ("# Unknown cmd: %s. Try cap, list, nodes, config, fetch, version or quit\n",
+			    ("# Unknown cmd: %s. Try cap, list, nodes, config, fetch, history, alerts, configversions, version or quit\n",
 			     cmd);
 		}
 	}
@@ -715,9 +1395,51 @@ static int handle_connection()
 
 pid_t acquire(char *plugin_name, char *plugin_filename);
 
+static void wake_up(int sig)
+{
+	(void) sig;
+}
+
+/* Bound the spool of every plugin, before acquiring more and then
+ * periodically */
+static void compact_spools()
+{
+	DIR *dirp = opendir(spoolfetch_dir);
+	struct dirent *dp;
+	time_t now = time(NULL);
+
+	if (dirp == NULL) {
+		printf("# Cannot open spool dir\n");
+		return;
+	}
+	while ((dp = readdir(dirp)) != NULL) {
+		char path[LINE_MAX];
+		char *name = dp->d_name;
+		size_t len = strlen(name);
+
+		if (name[0] == '.' || (len > 4
+				       && !strcmp(name + len - 4, ".tmp"))) {
+			/* No dotted file, nor one being compacted */
+			continue;
+		}
+		snprintf(path, LINE_MAX, "%s/%s", spoolfetch_dir, name);
+		if (spool_compact(path, name, now, spool_max_age,
+				  spool_max_size) < 0)
+			printf("# Cannot compact %s\n", path);
+	}
+	closedir(dirp);
+}
+
 int acquire_all()
 {
-	DIR *dirp = opendir(plugin_dir);
+	DIR *dirp;
+	bool compacting = '\0' != *spoolfetch_dir
+	    && (spool_max_age || spool_max_size);
+
+	if (compacting)
+		compact_spools();
+
+	dirp = opendir(plugin_dir);
 	if (dirp == NULL) {
 		printf("# Cannot open plugin dir\n");
 		return (0);
@@ -753,10 +1475,22 @@ int acquire_all()
 		closedir(dirp);
 	}
 
-	/* wait for all childrens to end */
-	{
-		pid_t waited_pid;
-		while ((waited_pid = wait(NULL)) != -1);
+	/* wait for all childrens to end, compacting the spools meanwhile */
+	if (compacting) {
+		struct sigaction sa;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = wake_up;	/* no SA_RESTART */
+		sigaction(SIGALRM, &sa, NULL);
+		alarm(SPOOL_COMPACT_PERIOD);
+	}
+	for (;;) {
+		if (wait(NULL) != -1)
+			continue;
+		if (errno != EINTR)
+			break;
+		compact_spools();
+		alarm(SPOOL_COMPACT_PERIOD);
 	}
 
 	return 0;
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "plugindef.h"
+#include "../probes.h"
+
+#ifndef LINE_MAX
+#define LINE_MAX 2048
+#endif
+
+/* Sources are /proc and /sys files, much smaller than this */
+#define SOURCE_MAX 65536
+
+#define xisspace(x) isspace((int)(unsigned char) x)
+
+static const char BLANKS[] = " \t\r\n";
+
+/* Read a whole file into buf, NUL terminated.
+ * @returns 0 on success, -1 on error */
+static int read_source(const char *path, char *buf, size_t size)
+{
+	ssize_t len, n = 0;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	PROBE1(source__read__start, path);
+	for (len = 0; (size_t) len < size - 1; len += n)
+		if ((n = read(fd, buf + len, size - 1 - len)) <= 0)
+			break;
+	close(fd);
+	PROBE2(source__read__end, path, n < 0 ? -1 : len);
+	if (n < 0)
+		return -1;
+	buf[len] = '\0';
+	return 0;
+}
+
+/* Copy the word starting at s, if any, into value */
+static int copy_word(const char *s, char *value, size_t size)
+{
+	size_t len;
+
+	s += strspn(s, BLANKS);
+	len = strcspn(s, BLANKS);
+	if (len == 0 || len >= size)
+		return -1;
+	memcpy(value, s, len);
+	value[len] = '\0';
+	return 0;
+}
+
+static int source_key(const char *buf, const char *key, char *value,
+		      size_t size)
+{
+	size_t key_len = strlen(key);
+	const char *line, *next;
+
+	for (line = buf; line; line = next) {
+		if ((next = strchr(line, '\n')))
+			next++;
+		if (strncmp(line, key, key_len))
+			continue;
+		if (line[key_len] == ':')
+			return copy_word(line + key_len + 1, value, size);
+		if (line[key_len] == ' ' || line[key_len] == '\t')
+			return copy_word(line + key_len, value, size);
+	}
+	return -1;
+}
+
+static int source_line(const char *buf, int lineno, int col, char *value,
+		       size_t size)
+{
+	char line[LINE_MAX], *word;
+	const char *s = buf;
+	size_t len;
+
+	if (lineno < 1 || col < 1)
+		return -1;
+	for (; lineno > 1; lineno--)
+		if (!(s = strchr(s, '\n')))
+			return -1;
+		else
+			s++;
+
+	len = strcspn(s, "\n");
+	if (len >= sizeof(line))
+		return -1;
+	memcpy(line, s, len);
+	line[len] = '\0';
+	for (word = strtok(line, BLANKS); word && col > 1; col--)
+		word = strtok(NULL, BLANKS);
+	if (!word)
+		return -1;
+	return copy_word(word, value, size);
+}
+
+static int source_glob(const char *pattern, char *buf, size_t bufsize,
+		       char *value, size_t size)
+{
+	double sum = 0;
+	glob_t g;
+	size_t i;
+	int found = 0;
+
+	if (glob(pattern, 0, NULL, &g))
+		return -1;
+	for (i = 0; i < g.gl_pathc; i++) {
+		char *end;
+		double v;
+
+		if (read_source(g.gl_pathv[i], buf, bufsize))
+			continue;
+		v = strtod(buf, &end);
+		if (end == buf)
+			continue;
+		sum += v;
+		found++;
+	}
+	globfree(&g);
+	if (!found)
+		return -1;
+	snprintf(value, size, "%.17g", sum);
+	return 0;
+}
+
+/* Evaluate "<kind> <args...>", leaving the result in value */
+static int eval_source(char *spec, char *value, size_t size)
+{
+	static char buf[SOURCE_MAX];
+	char *kind, *path, *arg1, *arg2;
+
+	kind = strtok(spec, BLANKS);
+	path = strtok(NULL, BLANKS);
+	arg1 = strtok(NULL, BLANKS);
+	arg2 = strtok(NULL, BLANKS);
+	if (!kind || !path)
+		return -1;
+
+	if (!strcmp(kind, "glob"))
+		return source_glob(path, buf, sizeof(buf), value, size);
+	if (read_source(path, buf, sizeof(buf)))
+		return -1;
+	if (!strcmp(kind, "file"))
+		return copy_word(buf, value, size);
+	if (!strcmp(kind, "key") && arg1)
+		return source_key(buf, arg1, value, size);
+	if (!strcmp(kind, "line") && arg1 && arg2)
+		return source_line(buf, atoi(arg1), atoi(arg2), value, size);
+	return -1;
+}
+
+void plugindef_list(const char *dir, int (*skip) (const char *plugin),
+		    FILE *out)
+{
+	DIR *dirp = opendir(dir);
+	struct dirent *dp;
+
+	if (dirp == NULL)
+		return;
+	while ((dp = readdir(dirp)) != NULL) {
+		if (dp->d_name[0] == '.')
+			continue;
+		if (plugindef_exists(dir, dp->d_name)
+		    && !(skip && skip(dp->d_name)))
+			fprintf(out, "%s ", dp->d_name);
+	}
+	closedir(dirp);
+}
+
+/* Editor and package manager leftovers, as munin-node ignores them */
+static int is_backup(const char *name)
+{
+	static const char *const suffixes[] = {
+		"~", "#", ".bak", ".old", ".orig", ".swp", ".rej",
+		".rpmsave", ".rpmnew", ".rpmorig", ".dpkg-tmp", ".dpkg-new",
+		".dpkg-old", ".dpkg-dist", ".ucf-new", ".ucf-old",
+		".ucf-dist", NULL
+	};
+	size_t len = strlen(name), i;
+
+	for (i = 0; suffixes[i]; i++) {
+		size_t n = strlen(suffixes[i]);
+
+		if (len > n && !strcmp(name + len - n, suffixes[i]))
+			return 1;
+	}
+	return 0;
+}
+
+int plugindef_exists(const char *dir, const char *plugin)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (is_backup(plugin))
+		return 0;
+	snprintf(path, sizeof(path), "%s/%s", dir, plugin);
+	return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+int plugindef_run(const char *dir, const char *plugin, const char *cmd,
+		  FILE *out)
+{
+	char path[PATH_MAX], line[LINE_MAX];
+	int fetch = !strcmp(cmd, "fetch");
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, plugin);
+	if (!(f = fopen(path, "r")))
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *s = line, *dot, *end;
+		char value[64];
+
+		while (xisspace(*s))
+			s++;
+		if (*s == '\0' || *s == '#')
+			continue;
+		end = s + strcspn(s, BLANKS);
+		if (end - s < 8 || strncmp(end - 7, ".source", 7)) {
+			/* The values of a multigraph definition go to the
+			 * graph they follow */
+			if (!fetch || (end - s == 10
+				       && !strncmp(s, "multigraph", 10)))
+				fprintf(out, "%s%s", s,
+					strchr(s, '\n') ? "" : "\n");
+			continue;
+		}
+		if (!fetch)
+			continue;
+
+		/* Cut the field name, the spec follows */
+		dot = end - 7;
+		*dot = '\0';
+		if (eval_source(end, value, sizeof(value)))
+			fprintf(out, "%s.value U\n", s);
+		else
+			fprintf(out, "%s.value %s\n", s, value);
+	}
+	fclose(f);
+	return 0;
+}
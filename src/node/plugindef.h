@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef PLUGINDEF_H
+#define PLUGINDEF_H
+
+/** Declarative plugins are plain text files in the definition directory,
+ * named after the plugin. Every line is sent as is on config, except the
+ * ones giving the source of a field, which are only used on fetch:
+ *
+ *   <field>.source file <path>                first word of the file
+ *   <field>.source key <path> <key>           word after "<key>" or "<key>:"
+ *                                             at the start of a line
+ *   <field>.source line <path> <line> <col>   word col of line, from 1
+ *   <field>.source glob <pattern>             sum of the files matching
+ *
+ * Fields whose source cannot be read are reported as U. "multigraph" lines
+ * are sent on fetch too, so that the values go to their graph. */
+
+/** Write the names of the definitions in dir to out, each followed by a
+ * space, in the format of the "list" command. The names for which skip
+ * returns non-zero are left out. */
+void plugindef_list(const char *dir, int (*skip) (const char *plugin),
+		    FILE *out);
+
+/** Look up the definition of plugin in dir. Backup files such as "foo~" or
+ * "foo.dpkg-old" are ignored.
+ * @returns 1 if it exists, 0 otherwise */
+int plugindef_exists(const char *dir, const char *plugin);
+
+/** Answer "config" or "fetch" (cmd) for a plugin by evaluating its
+ * definition in-process, writing to out without the final "." line.
+ * @returns 0 on success, -1 if the definition cannot be read */
+int plugindef_run(const char *dir, const char *plugin, const char *cmd,
+		  FILE *out);
+
+#endif
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "spool.h"
+
+#ifndef LINE_MAX
+#define LINE_MAX 2048
+#endif
+
+#define SPOOL_FIELDS 256
+#define SPOOL_NAME_SIZE 128
+
+/* The samples of a field in the interval being folded */
+struct fold {
+	char graph[SPOOL_NAME_SIZE];
+	char field[SPOOL_NAME_SIZE];
+	bool open;
+	long bucket;
+	double sum, min, max;
+	long count;		/* known samples, U ones are not averaged */
+	long unknown;
+};
+
+struct compactor {
+	FILE *out;
+	const char *plugin;
+	char graph[SPOOL_NAME_SIZE];	/* of the last line written */
+	long first, last;	/* timestamps of the samples written */
+	int nb_folds;
+	struct fold folds[SPOOL_FIELDS];
+};
+
+/* A sample, with the weight it has from previous compactions */
+struct sample {
+	char *field;
+	long ts;
+	char *value;
+	double v, min, max;
+	long count;
+};
+
+/* Write a "multigraph" line when the graph differs from the last one */
+static void switch_graph(struct compactor *c, const char *graph)
+{
+	if (!strcmp(c->graph, graph))
+		return;
+	fprintf(c->out, "multigraph %s\n", graph[0] ? graph : c->plugin);
+	snprintf(c->graph, sizeof(c->graph), "%s", graph);
+}
+
+static void count_sample(struct compactor *c, long ts)
+{
+	if (c->first < 0 || ts < c->first)
+		c->first = ts;
+	if (ts > c->last)
+		c->last = ts;
+}
+
+static void print_number(FILE *out, double v)
+{
+	if (v == (long long) v)
+		fprintf(out, "%lld", (long long) v);
+	else
+		fprintf(out, "%.17g", v);
+}
+
+static void flush_fold(struct compactor *c, struct fold *f)
+{
+	if (!f->open)
+		return;
+	f->open = false;
+	switch_graph(c, f->graph);
+	count_sample(c, f->bucket);
+	if (f->count == 0) {
+		fprintf(c->out, "%s.value %ld:U\n", f->field, f->bucket);
+		return;
+	}
+	if (f->count > 1) {
+		fprintf(c->out, "# %s.range %ld:", f->field, f->bucket);
+		print_number(c->out, f->min);
+		fputc(':', c->out);
+		print_number(c->out, f->max);
+		fprintf(c->out, ":%ld\n", f->count);
+	}
+	fprintf(c->out, "%s.value %ld:", f->field, f->bucket);
+	print_number(c->out, f->sum / f->count);
+	fputc('\n', c->out);
+}
+
+static struct fold *find_fold(struct compactor *c, const char *graph,
+			      const char *field)
+{
+	struct fold *f;
+	int i;
+
+	for (i = 0; i < c->nb_folds; i++)
+		if (!strcmp(c->folds[i].field, field)
+		    && !strcmp(c->folds[i].graph, graph))
+			return c->folds + i;
+	if (c->nb_folds == SPOOL_FIELDS)
+		return NULL;
+	f = c->folds + c->nb_folds++;
+	memset(f, 0, sizeof(*f));
+	snprintf(f->graph, sizeof(f->graph), "%s", graph);
+	snprintf(f->field, sizeof(f->field), "%s", field);
+	return f;
+}
+
+static void fold_sample(struct fold *f, const struct sample *s, long bucket)
+{
+	if (!f->open) {
+		f->open = true;
+		f->bucket = bucket;
+		f->sum = f->count = f->unknown = 0;
+	}
+	if (!strcmp(s->value, "U")) {
+		f->unknown++;
+		return;
+	}
+	if (f->count == 0 || s->min < f->min)
+		f->min = s->min;
+	if (f->count == 0 || s->max > f->max)
+		f->max = s->max;
+	f->sum += s->v * s->count;
+	f->count += s->count;
+}
+
+/* Write a sample as it was read */
+static void keep_sample(struct compactor *c, const char *graph,
+			const struct sample *s)
+{
+	switch_graph(c, graph);
+	count_sample(c, s->ts);
+	if (s->count > 1) {
+		fprintf(c->out, "# %s.range %ld:", s->field, s->ts);
+		print_number(c->out, s->min);
+		fputc(':', c->out);
+		print_number(c->out, s->max);
+		fprintf(c->out, ":%ld\n", s->count);
+	}
+	fprintf(c->out, "%s.value %ld:%s\n", s->field, s->ts, s->value);
+}
+
+/* Parse "field.value ts:value" in place */
+static bool parse_sample(char *line, struct sample *s)
+{
+	char *dot, *colon;
+
+	if (!(s->value = strchr(line, ' ')))
+		return false;
+	*s->value++ = '\0';
+	if (!(dot = strstr(line, ".value")) || dot[6])
+		return false;
+	*dot = '\0';
+	if (!(colon = strchr(s->value, ':')))
+		return false;
+	*colon = '\0';
+	s->field = line;
+	s->ts = atol(s->value);
+	s->value = colon + 1;
+	s->v = s->min = s->max = strtod(s->value, NULL);
+	s->count = 1;
+	return true;
+}
+
+/* Whether a sample older than cutoff is not folded yet: folded ones are
+ * alone at the start of their interval, so that a spool already compacted
+ * is not rewritten again every time its oldest samples are still old */
+static bool unfolded_before(FILE *in, long cutoff)
+{
+	char line[LINE_MAX];
+	struct sample s;
+	bool found = false;
+
+	while (!found && fgets(line, sizeof(line), in)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (parse_sample(line, &s) && s.ts < cutoff
+		    && s.ts % SPOOL_INTERVAL != 0)
+			found = true;
+	}
+	rewind(in);
+	return found;
+}
+
+/* Fold the samples older than cutoff into one per interval, and drop the
+ * ones older than drop */
+static void compact(struct compactor *c, FILE *in, long cutoff, long interval,
+		    long drop)
+{
+	char line[LINE_MAX], graph[SPOOL_NAME_SIZE] = "";
+	char range_field[SPOOL_NAME_SIZE] = "";
+	double range_min = 0, range_max = 0;
+	long range_ts = 0, range_count = 0;
+	struct sample s;
+	struct fold *f;
+	int i;
+
+	while (fgets(line, sizeof(line), in)) {
+		line[strcspn(line, "\n")] = '\0';
+
+		if (!strncmp(line, "multigraph ", 11)) {
+			snprintf(graph, sizeof(graph), "%s",
+				 strcmp(line + 11, c->plugin) ?
+				 line + 11 : "");
+			continue;
+		}
+		if (!strncmp(line, "# ", 2)) {
+			/* The weight of the next sample */
+			char *dot = strstr(line, ".range ");
+			if (!dot)
+				continue;
+			*dot = '\0';
+			snprintf(range_field, sizeof(range_field), "%s",
+				 line + 2);
+			if (4 != sscanf(dot + 7, "%ld:%lf:%lf:%ld",
+					&range_ts, &range_min, &range_max,
+					&range_count))
+				range_field[0] = '\0';
+			continue;
+		}
+		if (!parse_sample(line, &s)) {
+			/* Unknown, kept as is */
+			switch_graph(c, graph);
+			fprintf(c->out, "%s\n", line);
+			continue;
+		}
+		if (!strcmp(range_field, s.field) && range_ts == s.ts) {
+			s.min = range_min;
+			s.max = range_max;
+			s.count = range_count;
+		}
+		range_field[0] = '\0';
+		if (s.ts < drop)
+			continue;
+
+		f = find_fold(c, graph, s.field);
+		if (s.ts >= cutoff || f == NULL) {
+			/* Still written in order */
+			if (f)
+				flush_fold(c, f);
+			keep_sample(c, graph, &s);
+			continue;
+		}
+		if (f->open && f->bucket != s.ts - s.ts % interval)
+			flush_fold(c, f);
+		fold_sample(f, &s, s.ts - s.ts % interval);
+	}
+
+	for (i = 0; i < c->nb_folds; i++)
+		flush_fold(c, c->folds + i);
+}
+
+/* Compact into an anonymous file, with coarser intervals and then without
+ * the oldest half of the samples until the result fits max_size */
+static FILE *compact_to_fit(struct compactor *c, FILE *in, long cutoff,
+			    off_t max_size)
+{
+	long interval = SPOOL_INTERVAL, drop = 0;
+	FILE *cur = in, *out;
+
+	for (;;) {
+		if (!(out = tmpfile()))
+			break;
+		memset(c->folds, 0, sizeof(c->folds));
+		c->nb_folds = 0;
+		c->graph[0] = '\0';
+		c->first = c->last = -1;
+		c->out = out;
+		compact(c, cur, cutoff, interval, drop);
+		if (cur != in)
+			fclose(cur);
+		cur = out;
+		if (fflush(out) != 0)
+			break;
+		if (!max_size || ftello(out) <= max_size)
+			return out;
+		if (interval < SPOOL_MAX_INTERVAL)
+			interval *= 4;
+		else if (c->first < c->last)
+			drop = c->first + (c->last - c->first) / 2 + 1;
+		else
+			return out;
+		rewind(out);
+	}
+	if (cur != in)
+		fclose(cur);
+	return NULL;
+}
+
+int spool_compact(const char *path, const char *plugin, time_t now,
+		  long max_age, off_t max_size)
+{
+	static struct compactor c;
+	char tmp[PATH_MAX], buf[4096];
+	struct stat st;
+	long cutoff;
+	size_t n;
+	FILE *in, *folded;
+	int fd, ret = -1;
+
+	if (!(in = fopen(path, "r")))
+		return -1;
+	/* Held until the rename, the writers wait for it */
+	if (flock(fileno(in), LOCK_EX) < 0 || fstat(fileno(in), &st) < 0) {
+		fclose(in);
+		return -1;
+	}
+	if (max_size && st.st_size > max_size) {
+		cutoff = now + 1;
+	} else if (max_age && unfolded_before(in, now - max_age)) {
+		cutoff = now - max_age;
+	} else {
+		fclose(in);
+		return 0;
+	}
+
+	memset(&c, 0, sizeof(c));
+	c.plugin = plugin;
+	if (!(folded = compact_to_fit(&c, in, cutoff, max_size))) {
+		fclose(in);
+		return -1;
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	unlink(tmp);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0644);
+	if (fd < 0 || !(c.out = fdopen(fd, "w"))) {
+		if (fd >= 0)
+			close(fd);
+		goto out;
+	}
+	rewind(folded);
+	while ((n = fread(buf, 1, sizeof(buf), folded)) > 0)
+		fwrite(buf, 1, n, c.out);
+
+	/* Whatever a writer not taking the lock appended while compacting,
+	 * in the context of its own graph */
+	clearerr(in);
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+		switch_graph(&c, "");
+		fwrite(buf, 1, n, c.out);
+	}
+
+	if (fclose(c.out) != 0 || rename(tmp, path) != 0)
+		unlink(tmp);
+	else
+		ret = 0;
+      out:
+	fclose(folded);
+	fclose(in);
+	return ret;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <sys/types.h>
+#include <time.h>
+
+/** Samples older than this are folded into one per interval. */
+#define SPOOL_INTERVAL 300
+
+/** The coarsest interval a spool too big is folded into. */
+#define SPOOL_MAX_INTERVAL 76800
+
+/** Seconds between two compactions in acquire mode. */
+#define SPOOL_COMPACT_PERIOD 600
+
+/** Compact the spool file of a plugin, made of "field.value timestamp:value"
+ * lines and "multigraph" lines, once it is bigger than max_size bytes or
+ * holds samples older than max_age seconds not folded yet (0 disables
+ * either check).
+ *
+ * The samples older than max_age, or all of them when the file is too big,
+ * are folded into one per SPOOL_INTERVAL and field: their average, preceded
+ * by a "# field.range timestamp:min:max:count" comment so that folding again
+ * keeps the right weights. While the result is still bigger than max_size
+ * the interval is made 4 times longer, up to SPOOL_MAX_INTERVAL, then the
+ * samples of the older half of the time covered are dropped, until it fits.
+ *
+ * The file is rewritten to a temporary file that is renamed over it, under
+ * an exclusive flock() of the spool: writers lock it too before appending,
+ * and reopen it if it was renamed over meanwhile.
+ * @returns 0 on success or when there was nothing to do, -1 on error */
+int spool_compact(const char *path, const char *plugin, time_t now,
+		  long max_age, off_t max_size);
+
+#endif
@@ -5,11 +5,16 @@
  * modify, copy, or redistribute it subject to the terms and conditions
  * of the GNU General Public License v.2 or v.3.
  */
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "common.h"
 
 #if !HAVE_DECL_ENVIRON
@@ -87,6 +92,172 @@ void print_warncrit(const char *name)
 	print_critical(name);
 }
 
+char *clean_fieldname(char *name)
+{
+	char *s = name;
+
+	if (xisdigit(*s))
+		*s = '_';
+	for (; *s; ++s)
+		if (!xisalnum(*s))
+			*s = '_';
+	return name;
+}
+
+int kv_next(char **cursor, char sep, char **key, char **value)
+{
+	char *line, *eol, *s;
+
+	for (line = *cursor; *line == '\n' || *line == '\r'; line++);
+	if (*line == '\0') {
+		*cursor = line;
+		return 0;
+	}
+
+	if ((eol = strchr(line, '\n'))) {
+		*cursor = eol + 1;
+		*eol = '\0';
+	} else {
+		*cursor = line + strlen(line);
+		eol = *cursor;
+	}
+	while (eol > line && (eol[-1] == '\r' || xisspace(eol[-1])))
+		*--eol = '\0';
+
+	*key = line;
+	if (!(s = strchr(line, sep))) {
+		*value = NULL;
+		return 1;
+	}
+	*s++ = '\0';
+	while (xisspace(*s))
+		++s;
+	*value = s;
+	return 1;
+}
+
+#define STATE_MAGIC 0x54534e4du	/* "MNST" */
+
+struct state_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t checksum;
+};
+
+/* FNV-1a */
+static uint32_t state_checksum(const void *record, size_t size)
+{
+	const unsigned char *s = record;
+	uint32_t h = 2166136261u;
+
+	while (size--)
+		h = (h ^ *s++) * 16777619u;
+	return h;
+}
+
+static void state_path(char *path, size_t size, const char *plugin)
+{
+	const char *file = getenv("MUNIN_STATEFILE");
+	const char *dir = getenv("MUNIN_PLUGSTATE");
+
+	/* Older nodes point it to /dev/null */
+	if (file != NULL && *file != '\0' && strcmp(file, "/dev/null")) {
+		snprintf(path, size, "%s", file);
+		return;
+	}
+	if (dir == NULL)
+		dir = "/var/tmp";
+	snprintf(path, size, "%s/%s.state", dir, plugin);
+}
+
+int state_load_file(const char *path, uint32_t version, void *record,
+		    size_t size)
+{
+	const struct state_header *h;
+	size_t length = sizeof(*h) + size;
+	struct stat st;
+	void *map;
+	int fd, ret = -1;
+
+	memset(record, 0, size);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size != length) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	h = map;
+	if (h->magic == STATE_MAGIC && h->version == version
+	    && h->size == size
+	    && h->checksum == state_checksum(h + 1, size)) {
+		memcpy(record, h + 1, size);
+		ret = 0;
+	}
+	munmap(map, length);
+	return ret;
+}
+
+int state_save_file(const char *path, uint32_t version, const void *record,
+		    size_t size)
+{
+	struct state_header h;
+	char tmp[PATH_MAX + 8];
+	FILE *f = NULL;
+	int fd;
+
+	h.magic = STATE_MAGIC;
+	h.version = version;
+	h.size = size;
+	h.checksum = state_checksum(record, size);
+
+	/* A new file only we can write, never one planted in a shared
+	 * directory like /var/tmp, made durable before it replaces the
+	 * previous state */
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if ((fd = mkstemp(tmp)) < 0)
+		return -1;
+	if (!(f = fdopen(fd, "w"))
+	    || fwrite(&h, sizeof(h), 1, f) != 1
+	    || fwrite(record, size, 1, f) != 1
+	    || fflush(f) != 0 || fsync(fd) != 0) {
+		if (f)
+			fclose(f);
+		else
+			close(fd);
+		unlink(tmp);
+		return -1;
+	}
+	if (fclose(f) != 0 || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+int state_load(const char *plugin, uint32_t version, void *record,
+	       size_t size)
+{
+	char path[PATH_MAX];
+
+	state_path(path, sizeof(path), plugin);
+	return state_load_file(path, version, record, size);
+}
+
+int state_save(const char *plugin, uint32_t version, const void *record,
+	       size_t size)
+{
+	char path[PATH_MAX];
+
+	state_path(path, sizeof(path), plugin);
+	return state_save_file(path, version, record, size);
+}
+
 int fail(const char *message)
 {
 	fputs(message, stderr);
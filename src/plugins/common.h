@@ -8,6 +8,9 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define PROC_STAT "/proc/stat"
 
 /** Write yes to stdout and return 0. The intended use is give an autoconf
@@ -35,11 +38,51 @@ void print_critical(const char *name);
  * variables. */
 void print_warncrit(const char *name);
 
+/** Turn a string into a valid munin field name in place, like
+ * clean_fieldname() of the Perl plugins: characters outside [A-Za-z0-9_]
+ * become _ and so does a leading digit.
+ * @returns its argument for convenience */
+char *clean_fieldname(char *name);
+
+/** Split the next "key<sep>value" line off the text at *cursor, in place.
+ * Blanks around the value and a trailing CR are removed, empty lines are
+ * skipped. A line without sep gives the whole line as key and a NULL value.
+ * *cursor is advanced past the line.
+ * @returns 1 if a line was found, 0 at the end of the text */
+int kv_next(char **cursor, char sep, char **key, char **value);
+
+/** The state of a plugin is a single record of a fixed layout, kept in a
+ * binary file behind a header giving a magic, the version of the layout,
+ * its size and a checksum of the record. The file is $MUNIN_STATEFILE as
+ * set by the node, or <plugin>.state in $MUNIN_PLUGSTATE.
+ *
+ * Load the state of plugin into record, of the given size and version.
+ * @returns 0 on success, -1 if there is no valid state of that version and
+ * size, in which case record is zeroed */
+int state_load(const char *plugin, uint32_t version, void *record,
+	       size_t size);
+
+/** Save the state of plugin by writing a temporary file renamed over the
+ * previous one, so that it is never seen half written. The temporary file
+ * is a new one from mkstemp(), synced before the rename.
+ * @returns 0 on success, -1 on error */
+int state_save(const char *plugin, uint32_t version, const void *record,
+	       size_t size);
+
+/** The same as state_load() and state_save() for a record kept in the
+ * given file, for data that is not the state of the plugin itself. */
+int state_load_file(const char *path, uint32_t version, void *record,
+		    size_t size);
+int state_save_file(const char *path, uint32_t version, const void *record,
+		    size_t size);
+
 /** Fail by printing the given message and a newline to stderr.
  * @returns a failure state to be passed on as the return value from main */
 int fail(const char *message);
 
 #define xisspace(x) isspace((int)(unsigned char) x)
 #define xisdigit(x) isdigit((int)(unsigned char) x)
+#define xisalnum(x) isalnum((int)(unsigned char) x)
+#define xisalpha(x) isalpha((int)(unsigned char) x)
 
 #endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "fieldid.h"
+
+#define FIELD_IDS_VERSION 1
+#define HASH_LEN 8		/* hex digits */
+
+/* FNV-1a */
+static uint32_t hash_key(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *key; key++)
+		h = (h ^ (unsigned char) *key) * 16777619u;
+	return h;
+}
+
+static void ids_path(char *path, size_t size, const char *plugin)
+{
+	const char *dir = getenv("MUNIN_PLUGSTATE");
+
+	if (dir == NULL)
+		dir = "/var/tmp";
+	snprintf(path, size, "%s/%s.ids", dir, plugin);
+}
+
+void field_ids_load(struct field_ids *ids, const char *plugin)
+{
+	char path[PATH_MAX];
+
+	ids_path(path, sizeof(path), plugin);
+	if (state_load_file(path, FIELD_IDS_VERSION, ids, sizeof(*ids)))
+		ids->nb = 0;
+	if (ids->nb < 0 || ids->nb > FIELD_IDS_MAX)
+		ids->nb = 0;
+	ids->changed = false;
+}
+
+static bool name_taken(const struct field_ids *ids, const char *name)
+{
+	int i;
+
+	for (i = 0; i < ids->nb; i++)
+		if (!strcmp(ids->map[i].name, name))
+			return true;
+	return false;
+}
+
+/* The cleaned key, cut to leave room for a hash when too long */
+static void make_name(char *name, const char *key, uint32_t h, bool hashed)
+{
+	size_t len;
+
+	snprintf(name, FIELD_ID_LEN + 1, "%s", key);
+	clean_fieldname(name);
+	if (strlen(key) <= FIELD_ID_LEN && !hashed)
+		return;
+	len = strlen(name);
+	if (len > FIELD_ID_LEN - HASH_LEN - 1)
+		len = FIELD_ID_LEN - HASH_LEN - 1;
+	snprintf(name + len, HASH_LEN + 2, "_%08x", h);
+}
+
+const char *field_id(struct field_ids *ids, const char *key)
+{
+	static char name[FIELD_ID_LEN + 1];
+	uint32_t h = hash_key(key);
+	bool hashed = false;
+	int i;
+
+	for (i = 0; i < ids->nb; i++)
+		if (!strcmp(ids->map[i].key, key))
+			return ids->map[i].name;
+
+	for (;;) {
+		make_name(name, key, h, hashed);
+		if (!name_taken(ids, name))
+			break;
+		/* Taken by another key, rehashed until free */
+		if (hashed)
+			h = h * 16777619u + 1;
+		hashed = true;
+	}
+
+	/* Keys too long to be told apart are not kept */
+	if (ids->nb < FIELD_IDS_MAX && strlen(key) < FIELD_ID_KEY_SIZE) {
+		strcpy(ids->map[ids->nb].key, key);
+		strcpy(ids->map[ids->nb].name, name);
+		ids->nb++;
+		ids->changed = true;
+	}
+	return name;
+}
+
+int field_ids_save(const struct field_ids *ids, const char *plugin)
+{
+	char path[PATH_MAX];
+
+	if (!ids->changed)
+		return 0;
+	ids_path(path, sizeof(path), plugin);
+	return state_save_file(path, FIELD_IDS_VERSION, ids, sizeof(*ids));
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef FIELDID_H
+#define FIELDID_H
+
+#include <stdbool.h>
+
+/** Field names are at most this long. */
+#define FIELD_ID_LEN 32
+#define FIELD_ID_KEY_SIZE 128
+#define FIELD_IDS_MAX 256
+
+/** The field names given to persistent identifiers, such as a disk WWN or
+ * the source of a mount, so that a field keeps its name whatever else
+ * appears or disappears. An identifier is cleaned into a field name; one
+ * too long is cut and ends with a hash of the identifier, as is one whose
+ * name is already taken by another identifier. The names given are kept
+ * in $MUNIN_PLUGSTATE/<plugin>.ids, so that they do not depend on the
+ * order the identifiers are met in. */
+struct field_ids {
+	bool changed;
+	int nb;
+	struct {
+		char key[FIELD_ID_KEY_SIZE];
+		char name[FIELD_ID_LEN + 1];
+	} map[FIELD_IDS_MAX];
+};
+
+/** Load the names given before by plugin. */
+void field_ids_load(struct field_ids *ids, const char *plugin);
+
+/** The field name of an identifier, given now if it has none yet.
+ * @returns a name valid until the next call */
+const char *field_id(struct field_ids *ids, const char *key);
+
+/** Keep the names given, if there are new ones.
+ * @returns 0 on success, -1 on error */
+int field_ids_save(const struct field_ids *ids, const char *plugin);
+
+#endif
@@ -42,6 +42,21 @@ static int busybox(int argc, char **argv)
 		puts("memory");
 		puts("processes");
 		puts("external_");
+		puts("qdisc_");
+		puts("neigh_route");
+		puts("http_status_");
+		puts("kvstats_");
+		puts("logtail_");
+		puts("dircount_");
+		puts("procmem_");
+		puts("ps_");
+		puts("sysfs_");
+		puts("procfs_");
+		puts("snmp__if_multi");
+		puts("ping_");
+		puts("tcpping_");
+		puts("haproxy_");
+		puts("delayacct");
 	}
 
 	return 0;
@@ -52,6 +67,15 @@ int main(int argc, char **argv)
 	char *progname;
 	char *ext;
 	progname = basename(argv[0]);
+	/* These names end with a host or an interface, whose dots are no
+	 * extension */
+	if (!strncmp(progname, "qdisc_", strlen("qdisc_")))
+		return qdisc_(argc, argv);
+	if (!strncmp(progname, "ping_", strlen("ping_")) ||
+	    !strncmp(progname, "tcpping_", strlen("tcpping_")))
+		return ping_(argc, argv);
+	if (!strncmp(progname, "snmp_", strlen("snmp_")))
+		return snmp__if_multi(argc, argv);
 	ext = strrchr(progname, '.');
 	if (ext != NULL)
 		ext[0] = '\0';
@@ -61,8 +85,12 @@ int main(int argc, char **argv)
 			return cpu(argc, argv);
 		break;
 	case 'd':
+		if (!strcmp(progname, "delayacct"))
+			return delayacct(argc, argv);
 		if (!strcmp(progname, "df"))
 			return df(argc, argv);
+		if (!strncmp(progname, "dircount_", strlen("dircount_")))
+			return dircount_(argc, argv);
 		break;
 	case 'e':
 		if (!strcmp(progname, "entropy"))
@@ -76,6 +104,12 @@ int main(int argc, char **argv)
 		if (!strcmp(progname, "fw_packets"))
 			return fw_packets(argc, argv);
 		break;
+	case 'h':
+		if (!strncmp(progname, "haproxy_", strlen("haproxy_")))
+			return haproxy_(argc, argv);
+		if (!strncmp(progname, "http_status_", strlen("http_status_")))
+			return http_status_(argc, argv);
+		break;
 	case 'i':
 		if (!strcmp(progname, "interrupts"))
 			return interrupts(argc, argv);
@@ -84,9 +118,15 @@ int main(int argc, char **argv)
 		if (!strcmp(progname, "iostat"))
 			return iostat(argc, argv);
 		break;
+	case 'k':
+		if (!strncmp(progname, "kvstats_", strlen("kvstats_")))
+			return kvstats_(argc, argv);
+		break;
 	case 'l':
 		if (!strcmp(progname, "load"))
 			return load(argc, argv);
+		if (!strncmp(progname, "logtail_", strlen("logtail_")))
+			return logtail_(argc, argv);
 		break;
 	case 'm':
 		if (!strcmp(progname, "memory"))
@@ -94,6 +134,10 @@ int main(int argc, char **argv)
 		if (!strcmp(progname, "munin-plugins-c"))
 			return busybox(argc, argv);
 		break;
+	case 'n':
+		if (!strcmp(progname, "neigh_route"))
+			return neigh_route(argc, argv);
+		break;
 	case 'o':
 		if (!strcmp(progname, "open_files"))
 			return open_files(argc, argv);
@@ -103,10 +147,18 @@ int main(int argc, char **argv)
 	case 'p':
 		if (!strcmp(progname, "processes"))
 			return processes(argc, argv);
+		if (!strncmp(progname, "procmem_", strlen("procmem_")))
+			return procmem_(argc, argv);
+		if (!strncmp(progname, "ps_", strlen("ps_")))
+			return ps_(argc, argv);
+		if (!strncmp(progname, "procfs_", strlen("procfs_")))
+			return sysfs_(argc, argv);
 		break;
 	case 's':
 		if (!strcmp(progname, "swap"))
 			return swap(argc, argv);
+		if (!strncmp(progname, "sysfs_", strlen("sysfs_")))
+			return sysfs_(argc, argv);
 		break;
 	case 't':
 		if (!strcmp(progname, "threads"))
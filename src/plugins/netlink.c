@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifdef HAVE_LINUX_RTNETLINK_H
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <linux/genetlink.h>
+#include "netlink.h"
+#include "../probes.h"
+
+static unsigned int nl_seq;
+
+int nl_open(int protocol)
+{
+	struct sockaddr_nl sa;
+	int fd;
+
+	if ((fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol)) < 0)
+		return -1;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int nl_send(int fd, struct nlmsghdr *req)
+{
+	return nl_send_batch(fd, req, req->nlmsg_len);
+}
+
+int nl_send_batch(int fd, void *buf, size_t len)
+{
+	struct sockaddr_nl sa;
+	struct nlmsghdr *h;
+	size_t left = len;
+
+	for (h = buf; NLMSG_OK(h, left); h = NLMSG_NEXT(h, left)) {
+		h->nlmsg_seq = ++nl_seq;
+		h->nlmsg_pid = 0;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	if (sendto(fd, buf, len, 0, (struct sockaddr *) &sa,
+		   sizeof(sa)) != (ssize_t) len)
+		return -1;
+	return 0;
+}
+
+int nl_recv(int fd, nl_callback cb, void *data)
+{
+	/* Aligned for the NLMSG_* macros */
+	static long buf[NL_BUFSIZE / sizeof(long)];
+
+	for (;;) {
+		struct nlmsghdr *h;
+		ssize_t len;
+
+		len = recv(fd, buf, sizeof(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (len == 0)
+			return -1;
+
+		for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, (size_t) len);
+		     h = NLMSG_NEXT(h, len)) {
+			int ret;
+
+			if (h->nlmsg_type == NLMSG_DONE)
+				return 0;
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				const struct nlmsgerr *err = NLMSG_DATA(h);
+				if (err->error == 0)
+					return 0;	/* plain ACK */
+				errno = -err->error;
+				return -1;
+			}
+			if ((ret = cb(h, data)) != 0)
+				return ret;
+			if (!(h->nlmsg_flags & NLM_F_MULTI))
+				return 0;
+		}
+	}
+}
+
+int nl_dump(int fd, struct nlmsghdr *req, nl_callback cb, void *data)
+{
+	int ret;
+
+	PROBE1(source__read__start, "netlink");
+	req->nlmsg_flags |= NLM_F_REQUEST | NLM_F_DUMP;
+	ret = nl_send(fd, req) < 0 ? -1 : nl_recv(fd, cb, data);
+	PROBE2(source__read__end, "netlink", ret);
+	return ret;
+}
+
+static int genl_family_reply(const struct nlmsghdr *h, void *data)
+{
+	struct rtattr *tb[CTRL_ATTR_MAX + 1];
+	int len = h->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+
+	if (len < 0)
+		return 0;
+	nl_parse_attrs(tb, CTRL_ATTR_MAX, (struct rtattr *)
+		       ((char *) NLMSG_DATA(h) + GENL_HDRLEN), len);
+	if (tb[CTRL_ATTR_FAMILY_ID])
+		nl_attr_copy(data, sizeof(uint16_t), tb[CTRL_ATTR_FAMILY_ID]);
+	return 0;
+}
+
+int genl_family_id(int fd, const char *name)
+{
+	struct {
+		struct nlmsghdr h;
+		struct genlmsghdr g;
+		struct rtattr rta;
+		char name[GENL_NAMSIZ];
+	} req;
+	uint16_t id = 0;
+
+	if (strlen(name) >= sizeof(req.name))
+		return -1;
+	memset(&req, 0, sizeof(req));
+	req.rta.rta_type = CTRL_ATTR_FAMILY_NAME;
+	req.rta.rta_len = RTA_LENGTH(strlen(name) + 1);
+	strcpy(req.name, name);
+	req.h.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN)
+	    + RTA_ALIGN(req.rta.rta_len);
+	req.h.nlmsg_type = GENL_ID_CTRL;
+	req.h.nlmsg_flags = NLM_F_REQUEST;
+	req.g.cmd = CTRL_CMD_GETFAMILY;
+	req.g.version = 1;
+
+	if (nl_send(fd, &req.h) < 0
+	    || nl_recv(fd, genl_family_reply, &id) < 0 || id == 0)
+		return -1;
+	return id;
+}
+
+void nl_parse_attrs(struct rtattr **tb, int max, struct rtattr *rta,
+		    int len)
+{
+	memset(tb, 0, sizeof(*tb) * (max + 1));
+	for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		int type = rta->rta_type & NLA_TYPE_MASK;
+		if (type <= max)
+			tb[type] = rta;
+	}
+}
+
+void nl_attr_copy(void *dst, size_t size, const struct rtattr *rta)
+{
+	size_t len = RTA_PAYLOAD(rta);
+
+	if (len > size)
+		len = size;
+	memset(dst, 0, size);
+	memcpy(dst, RTA_DATA(rta), len);
+}
+#endif
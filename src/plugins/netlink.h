@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef NETLINK_H
+#define NETLINK_H
+
+#include <stddef.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+/** Size of the receive buffer used for netlink replies. The kernel never
+ * sends a datagram bigger than a page per default, so this leaves room. */
+#define NL_BUFSIZE 32768
+
+/** Callback invoked for each netlink reply message. Returning non-zero
+ * stops the dump and is passed on as the return value of nl_dump(). */
+typedef int (*nl_callback) (const struct nlmsghdr *, void *);
+
+/** Open and bind a netlink socket of the given protocol.
+ * @returns the socket or -1 on error */
+int nl_open(int protocol);
+
+/** Send a request. The sequence number and the pid are filled in.
+ * @returns 0 on success, -1 on error */
+int nl_send(int fd, struct nlmsghdr *req);
+
+/** Send several requests laid out one after the other in buf, in a single
+ * datagram. The kernel handles them in turn and answers each one. Their
+ * sequence numbers, consecutive, and their pids are filled in.
+ * @returns 0 on success, -1 on error */
+int nl_send_batch(int fd, void *buf, size_t len);
+
+/** Receive replies to an already sent request, feeding each message to cb,
+ * until NLMSG_DONE is seen or a non multipart message was handled. Only a
+ * single receive buffer is used, so memory stays constant whatever the size
+ * of the dump is.
+ * @returns 0 on success, -1 on error or the non-zero value of cb */
+int nl_recv(int fd, nl_callback cb, void *data);
+
+/** Send a dump request and process all the replies with cb. */
+int nl_dump(int fd, struct nlmsghdr *req, nl_callback cb, void *data);
+
+/** Look up the id of a generic netlink family, such as "TASKSTATS", on a
+ * NETLINK_GENERIC socket.
+ * @returns the id or -1 on error */
+int genl_family_id(int fd, const char *name);
+
+/** Index the attributes in the given stream by type into tb, which must have
+ * room for max + 1 entries. Unknown types are ignored. */
+void nl_parse_attrs(struct rtattr **tb, int max, struct rtattr *rta,
+		    int len);
+
+/** Copy the payload of an attribute into dst, zero-filling dst if the
+ * attribute is shorter. This copes with structs that grew over time. */
+void nl_attr_copy(void *dst, size_t size, const struct rtattr *rta);
+
+#endif
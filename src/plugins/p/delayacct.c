@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Delays of groups of processes waiting for the CPU, block I/O, swap-in
+ * and memory reclaim, from the delay accounting of the kernel.
+ *
+ * Environment:
+ *   groups         space separated group names
+ *   <group>_match  space separated shell patterns matched against comm, the
+ *                  group name by default
+ *   match          "cmdline" to match the patterns against the command line
+ *
+ * The processes are found in a single /proc scan, then their statistics
+ * are asked with TASKSTATS_CMD_GET on one generic netlink socket, many
+ * requests per datagram. The kernel needs delay accounting enabled
+ * (kernel.task_delayacct=1 or the delayacct boot option) and the queries
+ * need CAP_NET_ADMIN, so the plugin has to run as root.
+ *
+ * The totals of a process are lost when it exits, so a sum over the live
+ * ones would go backwards. Instead the totals of each process are kept in
+ * the state file, and only what they grew by since the previous run is
+ * added to the counters of its groups, kept there too. Beyond
+ * TRACKED_MAX processes, the ones not tracked yet are not counted. */
+
+#include <errno.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "plugins.h"
+#include "procscan.h"
+
+#ifndef HAVE_LINUX_RTNETLINK_H
+int delayacct(int argc, char **argv)
+{
+	if (argc && argv) {
+		/* Do nothing, but silence the warnings */
+	}
+	return fail("netlink is not supported on your system");
+}
+#else
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/genetlink.h>
+#include <linux/taskstats.h>
+#include "netlink.h"
+
+/* The replies of a batch have to fit the receive buffer of the socket */
+#define BATCH_SIZE 64
+#define TRACKED_MAX 4096
+
+struct delays {
+	uint64_t cpu;
+	uint64_t blkio;
+	uint64_t swapin;
+	uint64_t reclaim;
+};
+
+static const struct delayacct_graph {
+	const char *name;
+	const char *title;
+	const char *info;
+	size_t offset;
+} delayacct_graphs[] = {
+	{"cpu", "CPU run queue delay",
+	 "Time spent runnable, waiting for a CPU.",
+	 offsetof(struct delays, cpu)},
+	{"blkio", "Block I/O delay",
+	 "Time spent waiting for synchronous block I/O to complete.",
+	 offsetof(struct delays, blkio)},
+	{"swapin", "Swap-in delay",
+	 "Time spent waiting for pages to be swapped in.",
+	 offsetof(struct delays, swapin)},
+	{"reclaim", "Memory reclaim delay",
+	 "Time spent in direct reclaim, waiting for free pages.",
+	 offsetof(struct delays, reclaim)},
+	{NULL, NULL, NULL, 0}
+};
+
+#define DELAY_VALUE(d, off) (*(uint64_t *) ((char *) (d) + (off)))
+
+/* The totals of a process, told from a later one with the same pid by
+ * its start time */
+struct tracked {
+	int32_t pid;
+	uint32_t btime;
+	struct delays totals;
+};
+
+/* As kept in the state file */
+#define DELAYACCT_STATE_VERSION 1
+
+struct delayacct_record {
+	struct {
+		char name[PROC_NAME_SIZE];
+		struct delays delays;
+	} counters[PROC_MAX_GROUPS];
+	uint32_t nb;
+	uint32_t full;		/* more processes than tracked */
+	struct tracked procs[TRACKED_MAX];	/* by pid */
+};
+
+struct process {
+	int pid;
+	uint64_t groups;
+	bool answered;
+	struct tracked now;
+};
+
+struct processes {
+	struct process *list;
+	int nb, max;
+};
+
+static void collect(int pid, uint64_t groups, void *data)
+{
+	struct processes *procs = data;
+
+	if (procs->nb == procs->max) {
+		int max = procs->max ? 2 * procs->max : 256;
+		struct process *list = realloc(procs->list,
+					       max * sizeof(*list));
+
+		if (!list)
+			return;
+		procs->list = list;
+		procs->max = max;
+	}
+	memset(procs->list + procs->nb, 0, sizeof(*procs->list));
+	procs->list[procs->nb].pid = pid;
+	procs->list[procs->nb].groups = groups;
+	procs->nb++;
+}
+
+struct batch {
+	struct process *procs;
+	unsigned int first_seq;
+	int nb;
+};
+
+/* Keep the totals of a thread group */
+static int taskstats_reply(const struct nlmsghdr *h, void *data)
+{
+	struct batch *b = data;
+	struct rtattr *tb[TASKSTATS_TYPE_MAX + 1];
+	struct taskstats ts;
+	struct process *p;
+	unsigned int i = h->nlmsg_seq - b->first_seq;
+	int len = h->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+
+	if (len < 0 || i >= (unsigned int) b->nb)
+		return 0;
+	nl_parse_attrs(tb, TASKSTATS_TYPE_MAX, (struct rtattr *)
+		       ((char *) NLMSG_DATA(h) + GENL_HDRLEN), len);
+	if (!tb[TASKSTATS_TYPE_AGGR_TGID])
+		return 0;
+	nl_parse_attrs(tb, TASKSTATS_TYPE_MAX,
+		       RTA_DATA(tb[TASKSTATS_TYPE_AGGR_TGID]),
+		       RTA_PAYLOAD(tb[TASKSTATS_TYPE_AGGR_TGID]));
+	if (!tb[TASKSTATS_TYPE_STATS])
+		return 0;
+	nl_attr_copy(&ts, sizeof(ts), tb[TASKSTATS_TYPE_STATS]);
+
+	p = b->procs + i;
+	p->answered = true;
+	p->now.pid = p->pid;
+	p->now.btime = ts.ac_btime;
+	p->now.totals.cpu = ts.cpu_delay_total;
+	p->now.totals.blkio = ts.blkio_delay_total;
+	p->now.totals.swapin = ts.swapin_delay_total;
+	p->now.totals.reclaim = ts.freepages_delay_total;
+	return 0;
+}
+
+/* One TASKSTATS_CMD_GET per process, BATCH_SIZE to a datagram */
+static int query(int fd, int family, struct processes *procs)
+{
+	struct request {
+		struct nlmsghdr h;
+		struct genlmsghdr g;
+		struct rtattr rta;
+		uint32_t tgid;
+	} req[BATCH_SIZE];
+	struct batch b;
+	int start, i;
+
+	for (start = 0; start < procs->nb; start += BATCH_SIZE) {
+		b.procs = procs->list + start;
+		b.nb = procs->nb - start < BATCH_SIZE ?
+		    procs->nb - start : BATCH_SIZE;
+		memset(req, 0, sizeof(req));
+		for (i = 0; i < b.nb; i++) {
+			req[i].h.nlmsg_len = sizeof(req[i]);
+			req[i].h.nlmsg_type = family;
+			req[i].h.nlmsg_flags = NLM_F_REQUEST;
+			req[i].g.cmd = TASKSTATS_CMD_GET;
+			req[i].g.version = TASKSTATS_GENL_VERSION;
+			req[i].rta.rta_type = TASKSTATS_CMD_ATTR_TGID;
+			req[i].rta.rta_len = RTA_LENGTH(sizeof(uint32_t));
+			req[i].tgid = b.procs[i].pid;
+		}
+		if (nl_send_batch(fd, req, b.nb * sizeof(*req)) < 0)
+			return -1;
+		b.first_seq = req[0].h.nlmsg_seq;
+
+		/* Each request gets a reply, or an error when the process
+		 * has exited meanwhile */
+		for (i = 0; i < b.nb; i++)
+			if (nl_recv(fd, taskstats_reply, &b) < 0
+			    && errno != ESRCH)
+				return -1;
+	}
+	return 0;
+}
+
+static int by_pid(const void *a, const void *b)
+{
+	const struct tracked *x = a, *y = b;
+
+	return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+static uint64_t grown(uint64_t now, uint64_t before)
+{
+	return now >= before ? now - before : now;
+}
+
+/* Add what the totals of each process grew by since the previous run to
+ * the counters of its groups, and track the new totals */
+static void account(struct delayacct_record *rec,
+		    const struct processes *procs, struct delays *counters)
+{
+	static struct tracked seen[TRACKED_MAX];
+	uint32_t nb = 0;
+	bool full = false;
+	int i, g;
+
+	for (i = 0; i < procs->nb; i++) {
+		const struct process *p = procs->list + i;
+		const struct tracked *prev;
+		struct delays d;
+		uint64_t groups;
+
+		if (!p->answered)
+			continue;
+		prev = bsearch(&p->now, rec->procs, rec->nb,
+			       sizeof(*rec->procs), by_pid);
+		if (prev && prev->btime == p->now.btime) {
+			d.cpu = grown(p->now.totals.cpu, prev->totals.cpu);
+			d.blkio = grown(p->now.totals.blkio,
+					prev->totals.blkio);
+			d.swapin = grown(p->now.totals.swapin,
+					 prev->totals.swapin);
+			d.reclaim = grown(p->now.totals.reclaim,
+					  prev->totals.reclaim);
+		} else if (!rec->full) {
+			/* Started since */
+			d = p->now.totals;
+		} else {
+			memset(&d, 0, sizeof(d));
+		}
+		for (g = 0, groups = p->groups; groups; g++, groups >>= 1) {
+			if (!(groups & 1))
+				continue;
+			counters[g].cpu += d.cpu;
+			counters[g].blkio += d.blkio;
+			counters[g].swapin += d.swapin;
+			counters[g].reclaim += d.reclaim;
+		}
+		if (nb < TRACKED_MAX)
+			seen[nb++] = p->now;
+		else
+			full = true;
+	}
+	rec->full = full;
+	qsort(seen, nb, sizeof(*seen), by_pid);
+	memcpy(rec->procs, seen, nb * sizeof(*seen));
+	rec->nb = nb;
+}
+
+static void print_graph_name(const char *prefix, const char *name)
+{
+	printf("multigraph %s_%s\n", prefix, name);
+}
+
+int delayacct(int argc, char **argv)
+{
+	static struct proc_group groups[PROC_MAX_GROUPS];
+	static struct proc_matcher matcher;
+	static struct delays delays[PROC_MAX_GROUPS];
+	static struct delayacct_record rec;
+	struct processes procs = { NULL, 0, 0 };
+	struct timeval timeout = { 5, 0 };
+	const struct delayacct_graph *g;
+	const char *prefix;
+	int nb, i, fd, family;
+	FILE *f;
+
+	prefix = basename(argv[0]);
+	if ((nb = proc_groups_env(groups, &matcher)) < 0)
+		return 1;
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf")) {
+			int enabled = 1;
+
+			/* Linux 5.14 made it a sysctl, off by default */
+			f = fopen("/proc/sys/kernel/task_delayacct", "r");
+			if (f) {
+				if (fscanf(f, "%d", &enabled) != 1)
+					enabled = 0;
+				fclose(f);
+			}
+			if (!enabled) {
+				puts("no (kernel.task_delayacct is 0)");
+				return 0;
+			}
+			if (nb == 0) {
+				puts("no (env.groups is not set)");
+				return 0;
+			}
+			return writeyes();
+		}
+		if (!strcmp(argv[1], "config")) {
+			for (g = delayacct_graphs; g->name; g++) {
+				print_graph_name(prefix, g->name);
+				printf("graph_title %s\n"
+				       "graph_args --base 1000 -l 0\n"
+				       "graph_vlabel seconds per "
+				       "${graph_period}\n"
+				       "graph_category processes\n"
+				       "graph_info %s\n", g->title, g->info);
+				for (i = 0; i < nb; i++) {
+					const char *field = groups[i].field;
+
+					printf("%s.label %s\n%s.type DERIVE\n"
+					       "%s.min 0\n"
+					       "%s.cdef %s,1000000000,/\n",
+					       field, groups[i].label, field,
+					       field, field, field);
+					print_warncrit(field);
+				}
+			}
+			return 0;
+		}
+	}
+
+	if (nb == 0)
+		return fail("env.groups is not set");
+	if ((fd = nl_open(NETLINK_GENERIC)) < 0)
+		return fail("cannot open a generic netlink socket");
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if ((family = genl_family_id(fd, TASKSTATS_GENL_NAME)) < 0) {
+		close(fd);
+		return fail("taskstats is not supported by the kernel");
+	}
+	if (proc_scan(&matcher, collect, &procs) < 0) {
+		close(fd);
+		return fail("cannot read /proc");
+	}
+	i = query(fd, family, &procs);
+	close(fd);
+	if (i < 0) {
+		free(procs.list);
+		return fail("cannot query taskstats");
+	}
+
+	/* The counters by name, the groups may have changed since */
+	if (state_load(prefix, DELAYACCT_STATE_VERSION, &rec, sizeof(rec))
+	    || rec.nb > TRACKED_MAX)
+		memset(&rec, 0, sizeof(rec));
+	for (i = 0; i < nb; i++) {
+		int c;
+
+		for (c = 0; c < PROC_MAX_GROUPS; c++)
+			if (!strcmp(rec.counters[c].name, groups[i].field))
+				delays[i] = rec.counters[c].delays;
+	}
+	account(&rec, &procs, delays);
+	free(procs.list);
+	memset(rec.counters, 0, sizeof(rec.counters));
+	for (i = 0; i < nb; i++) {
+		strcpy(rec.counters[i].name, groups[i].field);
+		rec.counters[i].delays = delays[i];
+	}
+	if (state_save(prefix, DELAYACCT_STATE_VERSION, &rec, sizeof(rec)))
+		return fail("cannot write state file");
+
+	for (g = delayacct_graphs; g->name; g++) {
+		print_graph_name(prefix, g->name);
+		for (i = 0; i < nb; i++)
+			printf("%s.value %" PRIu64 "\n", groups[i].field,
+			       DELAY_VALUE(delays + i, g->offset));
+	}
+	return 0;
+}
+#endif
@@ -6,6 +6,7 @@
  * of the GNU General Public License v.2 or v.3.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -23,6 +24,7 @@
 #endif
 
 #include "common.h"
+#include "fieldid.h"
 
 /* Defines taken from statfs(2) man page: */
 #define ISOFS_SUPER_MAGIC     0x9660
@@ -45,21 +47,46 @@ int df(int argc, char **argv)
 }
 #else
 
-static char *replace_slash(char *c)
+/* The field of a mounted filesystem, or NULL when it is not shown: only
+ * those of a device, neither read-only by nature nor virtual, are, once
+ * per source */
+static const char *fs_field(struct field_ids *ids, struct mntent *fs,
+			    struct statfs *vfs, const char **seen, int *nb)
 {
-	char *p = c;
-
-	while (*p) {
-		if (*p == '/') {
-			*p = '_';
-		}
-		p++;
-	}
-	return c;
+	int i;
+
+	if (fs->mnt_fsname[0] != '/')
+		return NULL;
+	if (statfs(fs->mnt_dir, vfs) != 0)
+		return NULL;
+
+	if ((unsigned int) vfs->f_type == ISOFS_SUPER_MAGIC ||
+	    (unsigned int) vfs->f_type == SQUASHFS_MAGIC ||
+	    (unsigned int) vfs->f_type == UDF_SUPER_MAGIC ||
+	    (unsigned int) vfs->f_type == ROMFS_MAGIC ||
+	    (unsigned int) vfs->f_type == RAMFS_MAGIC ||
+	    (unsigned int) vfs->f_type == DEBUGFS_MAGIC ||
+	    (unsigned int) vfs->f_type == CGROUP_SUPER_MAGIC ||
+	    (unsigned int) vfs->f_type == DEVPTS_SUPER_MAGIC)
+		return NULL;
+
+	/* Bind mounts of the same source would give the same field twice */
+	for (i = 0; i < *nb; i++)
+		if (!strcmp(seen[i], fs->mnt_fsname))
+			return NULL;
+	if (*nb < FIELD_IDS_MAX && (seen[*nb] = strdup(fs->mnt_fsname)))
+		(*nb)++;
+
+	return field_id(ids, fs->mnt_fsname);
 }
 
 int df(int argc, char **argv)
 {
+	static struct field_ids ids;
+	const char *seen[FIELD_IDS_MAX];
+	const char *field;
+	int nb_seen = 0;
+	bool config;
 	FILE *fp;
 	struct mntent *fs;
 	struct statfs vfs;
@@ -69,77 +96,27 @@ int df(int argc, char **argv)
 		return fail("cannot open /etc/mtab");
 	}
 
-	if (argc > 1) {
-		if (strcmp(argv[1], "config") == 0) {
-			printf("graph_title Disk usage in percent\n"
-			       "graph_args --upper-limit 100 -l 0\n"
-			       "graph_vlabel %%\n"
-			       "graph_scale no\n" "graph_category disk\n");
-
-			while ((fs = getmntent(fp)) != NULL) {
-				if (fs->mnt_fsname[0] != '/') {
-					continue;
-				}
-
-				if (statfs(fs->mnt_dir, &vfs) != 0) {
-					continue;
-				}
-
-				if ((unsigned int) vfs.f_type ==
-				    ISOFS_SUPER_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    SQUASHFS_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    UDF_SUPER_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    ROMFS_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    RAMFS_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    DEBUGFS_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    CGROUP_SUPER_MAGIC
-				    || (unsigned int) vfs.f_type ==
-				    DEVPTS_SUPER_MAGIC) {
-					continue;
-				}
-
-				printf("%s.label %s\n",
-				       replace_slash(fs->mnt_fsname),
-				       fs->mnt_dir);
-			}
-			endmntent(fp);
-
-			return 0;
-		}
-	}
+	config = argc > 1 && strcmp(argv[1], "config") == 0;
+	if (config)
+		printf("graph_title Disk usage in percent\n"
+		       "graph_args --upper-limit 100 -l 0\n"
+		       "graph_vlabel %%\n"
+		       "graph_scale no\n" "graph_category disk\n");
 
-	/* Asking for a fetch */
+	field_ids_load(&ids, "df");
 	while ((fs = getmntent(fp)) != NULL) {
-		if (fs->mnt_fsname[0] != '/') {
-			continue;
-		}
-
-		if (statfs(fs->mnt_dir, &vfs) != 0) {
-			continue;
-		}
-
-		if ((unsigned int) vfs.f_type == ISOFS_SUPER_MAGIC ||
-		    (unsigned int) vfs.f_type == SQUASHFS_MAGIC ||
-		    (unsigned int) vfs.f_type == UDF_SUPER_MAGIC ||
-		    (unsigned int) vfs.f_type == ROMFS_MAGIC ||
-		    (unsigned int) vfs.f_type == RAMFS_MAGIC ||
-		    (unsigned int) vfs.f_type == DEBUGFS_MAGIC ||
-		    (unsigned int) vfs.f_type == CGROUP_SUPER_MAGIC ||
-		    (unsigned int) vfs.f_type == DEVPTS_SUPER_MAGIC) {
+		if (!(field = fs_field(&ids, fs, &vfs, seen, &nb_seen)))
 			continue;
-		}
 
-		printf("%s.value %lf\n", replace_slash(fs->mnt_fsname),
-		       (100.0 / vfs.f_blocks) * (vfs.f_blocks -
-						 vfs.f_bfree));
+		if (config)
+			printf("%s.label %s\n", field, fs->mnt_dir);
+		else
+			printf("%s.value %lf\n", field,
+			       (100.0 / vfs.f_blocks) * (vfs.f_blocks -
+							 vfs.f_bfree));
 	}
 	endmntent(fp);
+	field_ids_save(&ids, "df");
 
 	return 0;
 }
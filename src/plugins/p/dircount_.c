@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Number of files in queue and spool directories.
+ *
+ * Environment:
+ *   dirs         space separated directories to count
+ *   recursive    "yes" to descend into subdirectories
+ *   per_subdir   "yes" for a graph per directory breaking the count down
+ *                by first level subdirectory (implies recursive)
+ *   age_buckets  space separated ages in seconds, e.g. "300 3600", graphs
+ *                how many files are older than each
+ *
+ * Every non-directory entry counts as a file. The entries are read with
+ * getdents64 and a big buffer, relying on d_type to find subdirectories,
+ * and no file is stat()ed unless age buckets are configured, so that
+ * monitoring adds as little I/O as possible to an already full queue. */
+
+#define _GNU_SOURCE		/* O_NOATIME and statx */
+#include <dirent.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include "common.h"
+#include "plugins.h"
+
+#define DENTS_BUFSIZE (128 * 1024)
+#define MAX_DEPTH 16
+#define MAX_DIRS 16
+#define MAX_SUBDIRS 64
+#define MAX_BUCKETS 8
+#define FIELD_SIZE 64
+
+#ifndef SYS_getdents64
+int dircount_(int argc, char **argv)
+{
+	if (argc && argv) {
+		/* Do nothing, but silence the warnings */
+	}
+	return fail("getdents64 is not supported on your system");
+}
+#else
+
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct tally {
+	uint64_t files;
+	uint64_t older[MAX_BUCKETS];
+};
+
+struct subdir {
+	char name[FIELD_SIZE];
+	char field[FIELD_SIZE];
+	struct tally t;
+};
+
+struct dir {
+	const char *path;
+	char field[FIELD_SIZE];
+	bool ok;
+	struct tally t;
+	struct subdir subs[MAX_SUBDIRS];
+	int nb_subs;
+};
+
+static struct {
+	bool recursive;
+	bool per_subdir;
+	long buckets[MAX_BUCKETS];
+	int nb_buckets;
+	time_t now;
+} opts;
+
+/* One buffer per depth, since the parent's is still being walked */
+static char *dents_buf[MAX_DEPTH + 1];
+
+static int open_dir(int dirfd, const char *name)
+{
+	int fd;
+
+	/* Do not make the queue even busier updating its atime */
+	fd = openat(dirfd, name,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOATIME);
+	if (fd < 0)		/* O_NOATIME needs to own the directory */
+		fd = openat(dirfd, name,
+			    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return fd;
+}
+
+static bool is_dot(const char *name)
+{
+	return name[0] == '.' && (name[1] == '\0' ||
+				  (name[1] == '.' && name[2] == '\0'));
+}
+
+static bool entry_is_dir(int dirfd, const struct linux_dirent64 *d)
+{
+	struct stat sb;
+
+	if (d->d_type != DT_UNKNOWN)
+		return d->d_type == DT_DIR;
+	/* Some filesystems do not fill d_type */
+	if (fstatat(dirfd, d->d_name, &sb, AT_SYMLINK_NOFOLLOW) < 0)
+		return false;
+	return S_ISDIR(sb.st_mode);
+}
+
+static void tally_age(int dirfd, const char *name, struct tally *t)
+{
+	time_t mtime;
+	int b;
+
+#ifdef HAVE_STATX
+	struct statx stx;
+
+	if (statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+		  STATX_MTIME, &stx) < 0)
+		return;
+	mtime = stx.stx_mtime.tv_sec;
+#else
+	struct stat sb;
+
+	if (fstatat(dirfd, name, &sb, AT_SYMLINK_NOFOLLOW) < 0)
+		return;
+	mtime = sb.st_mtime;
+#endif
+	for (b = 0; b < opts.nb_buckets; b++)
+		if (opts.now - mtime > opts.buckets[b])
+			t->older[b]++;
+}
+
+static void tally_add(struct tally *dst, const struct tally *src)
+{
+	int b;
+
+	dst->files += src->files;
+	for (b = 0; b < opts.nb_buckets; b++)
+		dst->older[b] += src->older[b];
+}
+
+static struct subdir *add_subdir(struct dir *d, const char *name)
+{
+	struct subdir *s;
+
+	if (d->nb_subs == MAX_SUBDIRS)
+		return NULL;
+	s = &d->subs[d->nb_subs++];
+	snprintf(s->name, sizeof(s->name), "%s", name);
+	snprintf(s->field, sizeof(s->field), "%s", name);
+	clean_fieldname(s->field);
+	return s;
+}
+
+/* Count the files below fd, which is closed. With count false only the
+ * first level subdirectories are listed into subs, for config. Otherwise
+ * subdirectories go into subs when given, and are always added to t. */
+static void count_dir(int fd, int depth, struct tally *t, struct dir *subs,
+		      bool count)
+{
+	char *buf;
+	long n;
+
+	if (!dents_buf[depth]
+	    && !(dents_buf[depth] = malloc(DENTS_BUFSIZE))) {
+		close(fd);
+		return;
+	}
+	buf = dents_buf[depth];
+
+	while ((n = syscall(SYS_getdents64, fd, buf, DENTS_BUFSIZE)) > 0) {
+		long pos;
+
+		for (pos = 0; pos < n;) {
+			struct linux_dirent64 *d =
+			    (struct linux_dirent64 *) (buf + pos);
+			pos += d->d_reclen;
+
+			if (is_dot(d->d_name))
+				continue;
+			if (entry_is_dir(fd, d)) {
+				struct subdir *s = NULL;
+				struct tally sub;
+				int subfd;
+
+				if (!opts.recursive || depth == MAX_DEPTH)
+					continue;
+				if (subs)
+					s = add_subdir(subs, d->d_name);
+				if (!count)
+					continue;
+				if ((subfd = open_dir(fd, d->d_name)) < 0)
+					continue;
+				memset(&sub, 0, sizeof(sub));
+				count_dir(subfd, depth + 1, &sub, NULL,
+					  true);
+				if (s)
+					s->t = sub;
+				tally_add(t, &sub);
+				continue;
+			}
+			if (!count)
+				continue;
+			t->files++;
+			if (opts.nb_buckets)
+				tally_age(fd, d->d_name, t);
+		}
+	}
+	close(fd);
+}
+
+static int parse_config(struct dir *dirs)
+{
+	char *s, *tok;
+	int nb = 0;
+
+	if ((s = getenv("recursive")))
+		opts.recursive = !strcmp(s, "yes");
+	if ((s = getenv("per_subdir")) && !strcmp(s, "yes"))
+		opts.per_subdir = opts.recursive = true;
+	if ((s = getenv("age_buckets")))
+		for (tok = strtok(s, " \t"); tok; tok = strtok(NULL, " \t")) {
+			if (opts.nb_buckets == MAX_BUCKETS) {
+				fail("too many age buckets");
+				return -1;
+			}
+			opts.buckets[opts.nb_buckets++] = atol(tok);
+		}
+
+	if (!(s = getenv("dirs")))
+		return 0;
+	for (tok = strtok(s, " \t"); tok; tok = strtok(NULL, " \t")) {
+		if (nb == MAX_DIRS) {
+			fail("too many directories");
+			return -1;
+		}
+		dirs[nb].path = tok;
+		snprintf(dirs[nb].field, sizeof(dirs[nb].field), "%s", tok);
+		clean_fieldname(dirs[nb].field);
+		nb++;
+	}
+	return nb;
+}
+
+static void count_all(struct dir *dirs, int nb, bool count)
+{
+	int i;
+
+	opts.now = time(NULL);
+	for (i = 0; i < nb; i++) {
+		struct dir *d = dirs + i;
+		int fd = open_dir(AT_FDCWD, d->path);
+
+		if (fd < 0)
+			continue;
+		d->ok = true;
+		count_dir(fd, 0, &d->t, opts.per_subdir ? d : NULL, count);
+	}
+}
+
+static void print_value(const char *field, bool ok, uint64_t value)
+{
+	if (ok)
+		printf("%s.value %" PRIu64 "\n", field, value);
+	else
+		printf("%s.value U\n", field);
+}
+
+static void print_graphs(const char *plugin, const struct dir *dirs,
+			 int nb, bool config)
+{
+	int i, j, b;
+
+	printf("multigraph %s\n", plugin);
+	if (config)
+		printf("graph_title Files in %s\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel files\n"
+		       "graph_category disk\n"
+		       "graph_info Number of files in each directory%s.\n",
+		       plugin + 9,
+		       opts.recursive ? ", subdirectories included" : "");
+	for (i = 0; i < nb; i++) {
+		if (config) {
+			printf("%s.label %s\n", dirs[i].field, dirs[i].path);
+			print_warncrit(dirs[i].field);
+		} else {
+			print_value(dirs[i].field, dirs[i].ok,
+				    dirs[i].t.files);
+		}
+	}
+
+	if (opts.nb_buckets) {
+		printf("multigraph %s_age\n", plugin);
+		if (config)
+			printf("graph_title Age of files in %s\n"
+			       "graph_args --base 1000 -l 0\n"
+			       "graph_vlabel files\n"
+			       "graph_category disk\n"
+			       "graph_info Number of files older than each "
+			       "age.\n", plugin + 9);
+		for (i = 0; i < nb; i++)
+			for (b = 0; b < opts.nb_buckets; b++) {
+				char field[FIELD_SIZE + 24];
+				snprintf(field, sizeof(field), "%s_%ld",
+					 dirs[i].field, opts.buckets[b]);
+				if (config) {
+					printf("%s.label %s older than "
+					       "%lds\n", field, dirs[i].path,
+					       opts.buckets[b]);
+					print_warncrit(field);
+				} else {
+					print_value(field, dirs[i].ok,
+						    dirs[i].t.older[b]);
+				}
+			}
+	}
+
+	if (!opts.per_subdir)
+		return;
+	for (i = 0; i < nb; i++) {
+		printf("multigraph %s.%s\n", plugin, dirs[i].field);
+		if (config)
+			printf("graph_title Files in %s\n"
+			       "graph_args --base 1000 -l 0\n"
+			       "graph_vlabel files\n"
+			       "graph_category disk\n", dirs[i].path);
+		for (j = 0; j < dirs[i].nb_subs; j++) {
+			const struct subdir *s = &dirs[i].subs[j];
+			if (config)
+				printf("%s.label %s\n%s.draw %s\n", s->field,
+				       s->name, s->field,
+				       j ? "STACK" : "AREA");
+			else
+				print_value(s->field, true, s->t.files);
+		}
+	}
+}
+
+int dircount_(int argc, char **argv)
+{
+	static struct dir dirs[MAX_DIRS];
+	const char *plugin;
+	int nb;
+
+	plugin = basename(argv[0]);
+	if (strncmp(plugin, "dircount_", 9) != 0)
+		return fail("dircount_ invoked with invalid basename");
+
+	if ((nb = parse_config(dirs)) < 0)
+		return 1;
+
+	if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+		if (nb == 0) {
+			puts("no (env.dirs is not set)");
+			return 0;
+		}
+		return writeyes();
+	}
+	if (nb == 0)
+		return fail("env.dirs is not set");
+
+	if (argc > 1 && !strcmp(argv[1], "config")) {
+		/* The subdirectories have to be known, not their files */
+		if (opts.per_subdir)
+			count_all(dirs, nb, false);
+		print_graphs(plugin, dirs, nb, true);
+		return 0;
+	}
+
+	count_all(dirs, nb, true);
+	print_graphs(plugin, dirs, nb, false);
+	return 0;
+}
+#endif
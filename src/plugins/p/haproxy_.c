@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* HAProxy frontends and backends, from "show stat" on the stats socket.
+ *
+ * Environment:
+ *   socket   the stats socket, a path, unix:path or host:port,
+ *            /run/haproxy/admin.sock by default
+ *   timeout  in seconds, 5 by default
+ *
+ * A single "show stat" gives every graph. Its CSV is parsed line by line
+ * as it arrives, the columns being found by name in the header, and the
+ * server lines are skipped: the backend lines already sum them up, so
+ * thousands of servers cost no memory. */
+
+#include <inttypes.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "plugins.h"
+#include "sock.h"
+#include "../probes.h"
+
+#define HAPROXY_BUFSIZE 65536
+#define NAME_SIZE 64
+
+/* The columns we use, named as in the header */
+enum column {
+	COL_PXNAME, COL_SVNAME, COL_QCUR, COL_SCUR, COL_STOT, COL_BIN,
+	COL_BOUT, COL_EREQ, COL_ECON, COL_ERESP, COL_TYPE,
+	COL_HRSP_1XX, COL_HRSP_2XX, COL_HRSP_3XX, COL_HRSP_4XX, COL_HRSP_5XX,
+	COL_HRSP_OTHER, NB_COLUMNS
+};
+
+static const char *const column_names[NB_COLUMNS] = {
+	"pxname", "svname", "qcur", "scur", "stot", "bin", "bout", "ereq",
+	"econ", "eresp", "type", "hrsp_1xx", "hrsp_2xx", "hrsp_3xx",
+	"hrsp_4xx", "hrsp_5xx", "hrsp_other"
+};
+
+#define HRSP_CLASSES (COL_HRSP_OTHER - COL_HRSP_1XX + 1)
+
+struct proxy {
+	char name[NAME_SIZE];
+	char field[NAME_SIZE + 4];
+	bool backend;
+	bool http;		/* has response codes */
+	uint64_t values[NB_COLUMNS];
+	bool present[NB_COLUMNS];
+};
+
+struct stats {
+	/* The column of each header position, or -1 */
+	int *positions;
+	int nb_positions;
+	struct proxy *proxies;
+	int nb_proxies, max_proxies;
+};
+
+static const char *stats_address(void)
+{
+	const char *address = getenv("socket");
+
+	return address ? address : "/run/haproxy/admin.sock";
+}
+
+static int parse_header(struct stats *st, char *line)
+{
+	char *name;
+	int c;
+
+	for (name = strtok(line + 1, ", \t"); name;
+	     name = strtok(NULL, ", \t")) {
+		int *p = realloc(st->positions,
+				 (st->nb_positions + 1) * sizeof(*p));
+
+		if (!p)
+			return fail("out of memory");
+		st->positions = p;
+		p[st->nb_positions] = -1;
+		for (c = 0; c < NB_COLUMNS; c++)
+			if (!strcmp(name, column_names[c]))
+				p[st->nb_positions] = c;
+		st->nb_positions++;
+	}
+	return 0;
+}
+
+static int parse_row(struct stats *st, char *line)
+{
+	const char *fields[NB_COLUMNS] = { NULL };
+	struct proxy *px;
+	char *s = line;
+	bool backend;
+	int i, c;
+
+	/* HAProxy never quotes its fields */
+	for (i = 0; i < st->nb_positions && s; i++) {
+		char *comma = strchr(s, ',');
+
+		if (comma)
+			*comma = '\0';
+		if (st->positions[i] >= 0)
+			fields[st->positions[i]] = s;
+		s = comma ? comma + 1 : NULL;
+	}
+	if (!fields[COL_PXNAME] || !fields[COL_SVNAME])
+		return 0;
+	/* type is 0 for frontends, 1 for backends, 2 for servers and 3 for
+	 * listeners; older versions only have the svname */
+	if (fields[COL_TYPE] && *fields[COL_TYPE])
+		c = atoi(fields[COL_TYPE]);
+	else if (!strcmp(fields[COL_SVNAME], "FRONTEND"))
+		c = 0;
+	else if (!strcmp(fields[COL_SVNAME], "BACKEND"))
+		c = 1;
+	else
+		c = 2;
+	if (c != 0 && c != 1)
+		return 0;
+	backend = c == 1;
+
+	if (st->nb_proxies == st->max_proxies) {
+		int max = st->max_proxies ? 2 * st->max_proxies : 64;
+
+		if (!(px = realloc(st->proxies, max * sizeof(*px))))
+			return fail("out of memory");
+		st->proxies = px;
+		st->max_proxies = max;
+	}
+	px = st->proxies + st->nb_proxies++;
+	memset(px, 0, sizeof(*px));
+	snprintf(px->name, sizeof(px->name), "%s", fields[COL_PXNAME]);
+	snprintf(px->field, sizeof(px->field), "%s_%s", px->name,
+		 backend ? "be" : "fe");
+	clean_fieldname(px->field);
+	px->backend = backend;
+	for (c = COL_QCUR; c < NB_COLUMNS; c++) {
+		if (!fields[c] || !*fields[c])
+			continue;
+		px->values[c] = strtoull(fields[c], NULL, 10);
+		px->present[c] = true;
+		if (c >= COL_HRSP_1XX)
+			px->http = true;
+	}
+	return 0;
+}
+
+static int parse_line(struct stats *st, char *line)
+{
+	if (line[0] == '#')
+		return st->positions ? 0 : parse_header(st, line);
+	if (!st->positions || !*line)
+		return 0;
+	return parse_row(st, line);
+}
+
+/* Reads the CSV as it comes, keeping only the incomplete last line */
+static int query(struct stats *st)
+{
+	static const char cmd[] = "show stat\n";
+	static char buf[HAPROXY_BUFSIZE];
+	long long deadline;
+	size_t len = 0;
+	char *line, *eol;
+	int fd, ret = 0;
+
+	deadline = sock_now_ms() + 1000LL * getenvint("timeout", 5);
+	if ((fd = sock_connect(stats_address(), NULL, deadline)) < 0)
+		return fail("cannot connect to the stats socket");
+	if (sock_send(fd, cmd, strlen(cmd), deadline) < 0) {
+		close(fd);
+		return fail("cannot send to the stats socket");
+	}
+
+	for (;;) {
+		ssize_t r = sock_recv(fd, buf + len, sizeof(buf) - 1 - len,
+				      deadline);
+
+		if (r < 0) {
+			ret = fail("cannot read the stats socket");
+			break;
+		}
+		len += r;
+		buf[len] = '\0';
+		for (line = buf; ret == 0 && (eol = strchr(line, '\n'));
+		     line = eol + 1) {
+			*eol = '\0';
+			ret = parse_line(st, line);
+		}
+		if (r == 0 && ret == 0 && *line)
+			ret = parse_line(st, line);
+		if (r == 0 || ret)
+			break;
+		len -= line - buf;
+		memmove(buf, line, len);
+		if (len + 1 == sizeof(buf)) {
+			ret = fail("line too long on the stats socket");
+			break;
+		}
+	}
+	close(fd);
+	if (ret == 0 && !st->positions)
+		return fail("no statistics on the stats socket");
+	return ret;
+}
+
+static void print_config(const char *prefix, const struct stats *st)
+{
+	static const char *const classes[HRSP_CLASSES] = {
+		"1xx", "2xx", "3xx", "4xx", "5xx", "other"
+	};
+	const struct proxy *px;
+	int c;
+
+	printf("multigraph %s_sessions\n"
+	       "graph_title HAProxy current sessions\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel sessions\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		printf("%s.label %s %s\n", px->field, px->name,
+		       px->backend ? "backend" : "frontend");
+		print_warncrit(px->field);
+	}
+
+	printf("multigraph %s_session_rate\n"
+	       "graph_title HAProxy sessions\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel sessions per ${graph_period}\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		printf("%s.label %s %s\n%s.type DERIVE\n%s.min 0\n",
+		       px->field, px->name,
+		       px->backend ? "backend" : "frontend", px->field,
+		       px->field);
+
+	printf("multigraph %s_bytes\n"
+	       "graph_title HAProxy traffic\n"
+	       "graph_args --base 1000\n"
+	       "graph_vlabel bits in (-) / out (+) per ${graph_period}\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		const char *f = px->field;
+
+		printf("%s_in.label %s\n%s_in.type DERIVE\n%s_in.min 0\n"
+		       "%s_in.graph no\n%s_in.cdef %s_in,8,*\n", f, f, f, f,
+		       f, f, f);
+		printf("%s_out.label %s %s\n%s_out.type DERIVE\n"
+		       "%s_out.min 0\n%s_out.negative %s_in\n"
+		       "%s_out.cdef %s_out,8,*\n", f, px->name,
+		       px->backend ? "backend" : "frontend", f, f, f, f, f,
+		       f);
+	}
+
+	printf("multigraph %s_errors\n"
+	       "graph_title HAProxy request, connection and response errors\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel errors per ${graph_period}\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		printf("%s.label %s %s\n%s.type DERIVE\n%s.min 0\n",
+		       px->field, px->name,
+		       px->backend ? "backend" : "frontend", px->field,
+		       px->field);
+		print_warncrit(px->field);
+	}
+
+	printf("multigraph %s_queue\n"
+	       "graph_title HAProxy queued requests\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel requests\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		if (px->backend) {
+			printf("%s.label %s\n", px->field, px->name);
+			print_warncrit(px->field);
+		}
+
+	/* The responses of each HTTP proxy, by class of status code */
+	printf("multigraph %s_responses\n"
+	       "graph_title HAProxy HTTP responses\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel responses per ${graph_period}\n"
+	       "graph_category loadbalancer\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		if (px->http)
+			printf("%s.label %s %s\n%s.type DERIVE\n%s.min 0\n",
+			       px->field, px->name,
+			       px->backend ? "backend" : "frontend",
+			       px->field, px->field);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		if (!px->http)
+			continue;
+		printf("multigraph %s_responses.%s\n"
+		       "graph_title HAProxy HTTP responses of %s %s\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel responses per ${graph_period}\n"
+		       "graph_category loadbalancer\n", prefix, px->field,
+		       px->backend ? "backend" : "frontend", px->name);
+		for (c = 0; c < HRSP_CLASSES; c++)
+			printf("hrsp_%s.label %s\nhrsp_%s.type DERIVE\n"
+			       "hrsp_%s.min 0\nhrsp_%s.draw %s\n",
+			       classes[c], classes[c], classes[c],
+			       classes[c], classes[c],
+			       c ? "STACK" : "AREA");
+	}
+}
+
+static void print_value(const char *field, const struct proxy *px,
+			enum column c)
+{
+	if (px->present[c])
+		printf("%s.value %" PRIu64 "\n", field, px->values[c]);
+	else
+		printf("%s.value U\n", field);
+}
+
+static void print_fetch(const char *prefix, const struct stats *st)
+{
+	const struct proxy *px;
+	char field[NAME_SIZE + 8];
+	int c;
+
+	printf("multigraph %s_sessions\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		print_value(px->field, px, COL_SCUR);
+	printf("multigraph %s_session_rate\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		print_value(px->field, px, COL_STOT);
+
+	printf("multigraph %s_bytes\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		snprintf(field, sizeof(field), "%s_in", px->field);
+		print_value(field, px, COL_BIN);
+		snprintf(field, sizeof(field), "%s_out", px->field);
+		print_value(field, px, COL_BOUT);
+	}
+
+	/* Frontends only have request errors, backends the other two */
+	printf("multigraph %s_errors\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		if (px->present[COL_EREQ] || px->present[COL_ECON]
+		    || px->present[COL_ERESP])
+			printf("%s.value %" PRIu64 "\n", px->field,
+			       px->values[COL_EREQ] + px->values[COL_ECON] +
+			       px->values[COL_ERESP]);
+		else
+			printf("%s.value U\n", px->field);
+
+	printf("multigraph %s_queue\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++)
+		if (px->backend)
+			print_value(px->field, px, COL_QCUR);
+
+	printf("multigraph %s_responses\n", prefix);
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		uint64_t total = 0;
+
+		if (!px->http)
+			continue;
+		for (c = COL_HRSP_1XX; c <= COL_HRSP_OTHER; c++)
+			total += px->values[c];
+		printf("%s.value %" PRIu64 "\n", px->field, total);
+	}
+	for (px = st->proxies; px < st->proxies + st->nb_proxies; px++) {
+		if (!px->http)
+			continue;
+		printf("multigraph %s_responses.%s\n", prefix, px->field);
+		for (c = COL_HRSP_1XX; c <= COL_HRSP_OTHER; c++)
+			print_value(column_names[c], px, c);
+	}
+}
+
+int haproxy_(int argc, char **argv)
+{
+	struct stats st = { NULL, 0, NULL, 0, 0 };
+	char prefix[NAME_SIZE];
+	size_t len;
+	int ret;
+
+	/* haproxy_ gives "haproxy" graphs, haproxy_lb1 "haproxy_lb1" ones */
+	snprintf(prefix, sizeof(prefix), "%s", basename(argv[0]));
+	len = strlen(prefix);
+	if (len && prefix[len - 1] == '_')
+		prefix[len - 1] = '\0';
+	clean_fieldname(prefix);
+
+	if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+		long long deadline = sock_now_ms() + 1000;
+		int fd;
+
+		if ((fd = sock_connect(stats_address(), NULL, deadline)) < 0) {
+			printf("no (cannot connect to %s)\n",
+			       stats_address());
+			return 0;
+		}
+		close(fd);
+		return writeyes();
+	}
+
+	PROBE1(source__read__start, "haproxy");
+	ret = query(&st);
+	PROBE2(source__read__end, "haproxy", ret);
+	if (ret == 0) {
+		if (argc > 1 && !strcmp(argv[1], "config"))
+			print_config(prefix, &st);
+		else
+			print_fetch(prefix, &st);
+	}
+	free(st.positions);
+	free(st.proxies);
+	return ret;
+}
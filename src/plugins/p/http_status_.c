@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* nginx stub_status and Apache mod_status "?auto" pages, fetched with a
+ * minimal HTTP/1.1 client instead of LWP, all graphs in one multigraph.
+ *
+ * Environment:
+ *   url      the status page, e.g. http://127.0.0.1/nginx_status
+ *   socket   connect to this unix socket (or host:port) instead of the
+ *            host of the url, which is then only sent as Host header
+ *   type     nginx or apache, detected from the basename
+ *            (http_status_nginx*, http_status_apache*) or the page itself
+ *   timeout  in seconds for the whole request, 5 by default */
+
+#include <ctype.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "common.h"
+#include "plugins.h"
+#include "sock.h"
+
+#define HTTP_BUFSIZE 16384
+
+enum server_type { TYPE_UNKNOWN, TYPE_NGINX, TYPE_APACHE };
+
+static const struct {
+	char c;
+	const char *name;
+	const char *label;
+} scoreboard_keys[] = {
+	{'_', "waiting", "Waiting for connection"},
+	{'S', "starting", "Starting up"},
+	{'R', "reading", "Reading request"},
+	{'W', "sending", "Sending reply"},
+	{'K', "keepalive", "Keepalive (read)"},
+	{'D', "dns", "DNS lookup"},
+	{'C', "closing", "Closing connection"},
+	{'L', "logging", "Logging"},
+	{'G', "graceful", "Gracefully finishing"},
+	{'I', "idle_cleanup", "Idle cleanup of worker"},
+	{'.', "open", "Open slot with no current process"},
+	{0, NULL, NULL}
+};
+
+#define SCOREBOARD_NB (sizeof(scoreboard_keys) / sizeof(*scoreboard_keys) - 1)
+
+struct status {
+	enum server_type type;
+	/* nginx */
+	uint64_t active, reading, writing, waiting;
+	uint64_t accepts, handled, requests;
+	/* apache */
+	uint64_t accesses, kbytes, busy, idle;
+	uint64_t scoreboard[SCOREBOARD_NB];
+};
+
+/* Split http://host[:port]/path into its parts */
+static int parse_url(const char *url, char *host, size_t host_size,
+		     const char **path)
+{
+	const char *s;
+	size_t len;
+
+	if (strncmp(url, "http://", 7) != 0)
+		return -1;
+	url += 7;
+	if (!(s = strchr(url, '/')))
+		s = url + strlen(url);
+	len = s - url;
+	if (len == 0 || len >= host_size)
+		return -1;
+	memcpy(host, url, len);
+	host[len] = '\0';
+	*path = *s ? s : "/";
+	return 0;
+}
+
+/* Find the end of the headers, NULL if they are not complete yet */
+static char *http_body(const char *buf)
+{
+	char *s;
+
+	if ((s = strstr(buf, "\r\n\r\n")))
+		return s + 4;
+	if ((s = strstr(buf, "\n\n")))
+		return s + 2;
+	return NULL;
+}
+
+/* Look a header value up, the headers ending at body */
+static const char *http_header(const char *buf, const char *body,
+			       const char *name)
+{
+	size_t len = strlen(name);
+	const char *line;
+
+	for (line = strchr(buf, '\n'); line && line < body;
+	     line = strchr(line, '\n')) {
+		line++;
+		if (strncasecmp(line, name, len) == 0 && line[len] == ':') {
+			line += len + 1;
+			while (xisspace(*line) && *line != '\n')
+				line++;
+			return line;
+		}
+	}
+	return NULL;
+}
+
+/* The server closes the connection, but stop early if the announced
+ * Content-Length is already there. */
+static bool http_is_complete(const char *buf, size_t len, void *data)
+{
+	const char *body, *cl;
+
+	(void) data;
+	if (!(body = http_body(buf)))
+		return false;
+	if (!(cl = http_header(buf, body, "Content-Length")))
+		return false;
+	return (size_t) (body - buf) + strtoul(cl, NULL, 10) <= len;
+}
+
+/* Decode a chunked body in place */
+static void http_dechunk(char *body)
+{
+	char *src = body, *dst = body, *end;
+	unsigned long size;
+
+	for (;;) {
+		size = strtoul(src, &end, 16);
+		if (end == src || !(src = strchr(end, '\n')))
+			break;
+		src++;
+		if (size == 0 || strlen(src) < size)
+			break;
+		memmove(dst, src, size);
+		dst += size;
+		src += size;
+		if (*src == '\r')
+			src++;
+		if (*src == '\n')
+			src++;
+	}
+	*dst = '\0';
+}
+
+/* Fetch the page into buf, returning the body or NULL on error */
+static char *http_get(char *buf, size_t size)
+{
+	char host[256], req[1024];
+	const char *url, *path, *address, *te;
+	long long deadline;
+	char *body;
+	int fd, len;
+	ssize_t n;
+
+	url = getenv("url");
+	if (url == NULL)
+		url = "http://localhost/server-status?auto";
+	if (parse_url(url, host, sizeof(host), &path) < 0) {
+		fail("invalid url, expecting http://host[:port]/path");
+		return NULL;
+	}
+	address = getenv("socket");
+	if (address == NULL)
+		address = host;
+
+	len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\n"
+		       "Host: %s\r\n"
+		       "User-Agent: munin-c/" VERSION "\r\n"
+		       "Connection: close\r\n\r\n", path, host);
+	if (len < 0 || (size_t) len >= sizeof(req)) {
+		fail("url too long");
+		return NULL;
+	}
+
+	deadline = sock_now_ms() + 1000LL * getenvint("timeout", 5);
+	if ((fd = sock_connect(address, "80", deadline)) < 0) {
+		fail("cannot connect to server");
+		return NULL;
+	}
+	n = sock_transact(fd, req, len, buf, size, deadline,
+			  http_is_complete, NULL);
+	close(fd);
+	if (n < 0) {
+		fail("no response from server");
+		return NULL;
+	}
+
+	if (strncmp(buf, "HTTP/1.", 7) != 0 || strncmp(buf + 8, " 200", 4)) {
+		fail("unexpected HTTP status");
+		return NULL;
+	}
+	if (!(body = http_body(buf))) {
+		fail("truncated HTTP response");
+		return NULL;
+	}
+	te = http_header(buf, body, "Transfer-Encoding");
+	if (te && strncasecmp(te, "chunked", 7) == 0)
+		http_dechunk(body);
+	return body;
+}
+
+static void parse_nginx(char *body, struct status *st)
+{
+	char *s;
+
+	if ((s = strstr(body, "Active connections:")))
+		st->active = strtoull(s + 19, NULL, 10);
+	if ((s = strstr(body, "requests")) && (s = strchr(s, '\n')))
+		sscanf(s, "%" SCNu64 " %" SCNu64 " %" SCNu64, &st->accepts,
+		       &st->handled, &st->requests);
+	if ((s = strstr(body, "Reading:")))
+		st->reading = strtoull(s + 8, NULL, 10);
+	if ((s = strstr(body, "Writing:")))
+		st->writing = strtoull(s + 8, NULL, 10);
+	if ((s = strstr(body, "Waiting:")))
+		st->waiting = strtoull(s + 8, NULL, 10);
+}
+
+static void parse_apache(char *body, struct status *st)
+{
+	char *key, *value;
+	size_t i;
+
+	while (kv_next(&body, ':', &key, &value)) {
+		if (value == NULL)
+			continue;
+		if (!strcmp(key, "Total Accesses"))
+			st->accesses = strtoull(value, NULL, 10);
+		else if (!strcmp(key, "Total kBytes"))
+			st->kbytes = strtoull(value, NULL, 10);
+		else if (!strcmp(key, "BusyWorkers"))
+			st->busy = strtoull(value, NULL, 10);
+		else if (!strcmp(key, "IdleWorkers"))
+			st->idle = strtoull(value, NULL, 10);
+		else if (!strcmp(key, "Scoreboard"))
+			for (; *value; value++)
+				for (i = 0; i < SCOREBOARD_NB; i++)
+					if (scoreboard_keys[i].c == *value)
+						st->scoreboard[i]++;
+	}
+}
+
+static enum server_type configured_type(const char *suffix)
+{
+	const char *type = getenv("type");
+
+	if (type == NULL)
+		type = suffix;
+	if (!strncmp(type, "nginx", 5))
+		return TYPE_NGINX;
+	if (!strncmp(type, "apache", 6))
+		return TYPE_APACHE;
+	return TYPE_UNKNOWN;
+}
+
+static int fetch_status(struct status *st)
+{
+	static char buf[HTTP_BUFSIZE];
+	char *body;
+
+	if (!(body = http_get(buf, sizeof(buf))))
+		return -1;
+	if (st->type == TYPE_UNKNOWN) {
+		if (strstr(body, "Active connections:"))
+			st->type = TYPE_NGINX;
+		else if (strstr(body, "Scoreboard:") ||
+			 strstr(body, "BusyWorkers:"))
+			st->type = TYPE_APACHE;
+		else {
+			fail("unknown status page format");
+			return -1;
+		}
+	}
+	if (st->type == TYPE_NGINX)
+		parse_nginx(body, st);
+	else
+		parse_apache(body, st);
+	return 0;
+}
+
+static void print_config(const char *prefix, enum server_type type)
+{
+	size_t i;
+
+	if (type == TYPE_NGINX) {
+		printf("multigraph %s_connections\n"
+		       "graph_title nginx connections\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel connections\n"
+		       "graph_category webserver\n"
+		       "active.label active\n"
+		       "active.draw LINE2\n"
+		       "reading.label reading\n"
+		       "writing.label writing\n"
+		       "waiting.label waiting\n", prefix);
+		print_warncrit("active");
+		printf("multigraph %s_requests\n"
+		       "graph_title nginx requests\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel requests per ${graph_period}\n"
+		       "graph_category webserver\n"
+		       "requests.label requests\n"
+		       "requests.type DERIVE\n"
+		       "requests.min 0\n", prefix);
+		printf("multigraph %s_accepts\n"
+		       "graph_title nginx accepted connections\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel connections per ${graph_period}\n"
+		       "graph_category webserver\n"
+		       "accepts.label accepted\n"
+		       "accepts.type DERIVE\n"
+		       "accepts.min 0\n"
+		       "handled.label handled\n"
+		       "handled.type DERIVE\n"
+		       "handled.min 0\n", prefix);
+		return;
+	}
+
+	printf("multigraph %s_accesses\n"
+	       "graph_title Apache accesses\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel accesses per ${graph_period}\n"
+	       "graph_category webserver\n"
+	       "accesses.label accesses\n"
+	       "accesses.type DERIVE\n" "accesses.min 0\n", prefix);
+	print_warncrit("accesses");
+	printf("multigraph %s_volume\n"
+	       "graph_title Apache volume\n"
+	       "graph_args --base 1024 -l 0\n"
+	       "graph_vlabel bytes per ${graph_period}\n"
+	       "graph_category webserver\n"
+	       "volume.label bytes\n"
+	       "volume.type DERIVE\n" "volume.min 0\n", prefix);
+	printf("multigraph %s_workers\n"
+	       "graph_title Apache workers\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel workers\n"
+	       "graph_category webserver\n"
+	       "busy.label busy\n"
+	       "busy.draw AREA\n"
+	       "idle.label idle\n" "idle.draw STACK\n", prefix);
+	print_warncrit("busy");
+	printf("multigraph %s_scoreboard\n"
+	       "graph_title Apache scoreboard\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel slots\n" "graph_category webserver\n", prefix);
+	for (i = 0; i < SCOREBOARD_NB; i++)
+		printf("%s.label %s\n%s.draw %s\n", scoreboard_keys[i].name,
+		       scoreboard_keys[i].label, scoreboard_keys[i].name,
+		       i ? "STACK" : "AREA");
+}
+
+#define PRINT_VALUE(name, v) \
+	(ok ? printf(name ".value %" PRIu64 "\n", (v)) \
+	    : printf(name ".value U\n"))
+
+static void print_fetch(const char *prefix, const struct status *st,
+			bool ok)
+{
+	size_t i;
+
+	if (st->type == TYPE_NGINX) {
+		printf("multigraph %s_connections\n", prefix);
+		PRINT_VALUE("active", st->active);
+		PRINT_VALUE("reading", st->reading);
+		PRINT_VALUE("writing", st->writing);
+		PRINT_VALUE("waiting", st->waiting);
+		printf("multigraph %s_requests\n", prefix);
+		PRINT_VALUE("requests", st->requests);
+		printf("multigraph %s_accepts\n", prefix);
+		PRINT_VALUE("accepts", st->accepts);
+		PRINT_VALUE("handled", st->handled);
+		return;
+	}
+
+	printf("multigraph %s_accesses\n", prefix);
+	PRINT_VALUE("accesses", st->accesses);
+	printf("multigraph %s_volume\n", prefix);
+	PRINT_VALUE("volume", st->kbytes * 1024);
+	printf("multigraph %s_workers\n", prefix);
+	PRINT_VALUE("busy", st->busy);
+	PRINT_VALUE("idle", st->idle);
+	printf("multigraph %s_scoreboard\n", prefix);
+	for (i = 0; i < SCOREBOARD_NB; i++) {
+		if (ok)
+			printf("%s.value %" PRIu64 "\n",
+			       scoreboard_keys[i].name, st->scoreboard[i]);
+		else
+			printf("%s.value U\n", scoreboard_keys[i].name);
+	}
+}
+
+int http_status_(int argc, char **argv)
+{
+	struct status st;
+	char *prefix;
+
+	prefix = basename(argv[0]);
+	if (strncmp(prefix, "http_status_", 12) != 0)
+		return fail("http_status_ invoked with invalid basename");
+
+	memset(&st, 0, sizeof(st));
+	st.type = configured_type(prefix + 12);
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf")) {
+			if (fetch_status(&st) < 0) {
+				puts("no (cannot fetch the status page)");
+				return 0;
+			}
+			return writeyes();
+		}
+		if (!strcmp(argv[1], "config")) {
+			if (st.type == TYPE_UNKNOWN && fetch_status(&st) < 0)
+				return 1;
+			print_config(prefix, st.type);
+			return 0;
+		}
+	}
+
+	if (fetch_status(&st) < 0) {
+		if (st.type == TYPE_UNKNOWN)
+			return 1;
+		/* Keep the graphs going with unknown values */
+		print_fetch(prefix, &st, false);
+		return 0;
+	}
+	print_fetch(prefix, &st, true);
+	return 0;
+}
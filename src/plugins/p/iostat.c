@@ -7,15 +7,19 @@
  */
 
 #include <ctype.h>
+#include <libgen.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "common.h"
+#include "fieldid.h"
 #include "plugins.h"
 
 #define PROC_DISKSTAT "/proc/diskstats"
+#define SYS_BLOCK "/sys/class/block"
 
 #define XSTR(x) #x
 #define STR(x) XSTR(x)
@@ -23,8 +27,7 @@
 
 struct dev {
 	struct dev *next;
-	uint8_t major;
-	char key[10];
+	char key[FIELD_ID_LEN + 1];
 	char name[NAME_SIZE + 1];
 	unsigned long rsect;
 	unsigned long wsect;
@@ -46,30 +49,88 @@ static bool is_numbered(struct dev *dev)
 	return false;
 }
 
+static bool read_line(const char *path, char *buf, size_t size)
+{
+	FILE *f = fopen(path, "r");
+	bool ok;
+
+	if (!f)
+		return false;
+	ok = fgets(buf, size, f) != NULL;
+	fclose(f);
+	buf[strcspn(buf, "\n")] = '\0';
+	return ok && buf[0] != '\0';
+}
+
+/* A persistent identifier of a block device, that does not change when
+ * other devices come and go: its WWN, UUID or serial number as found in
+ * sysfs, the one of its disk and its number for a partition, or its name
+ * when none is known. */
+static void device_id(const char *name, char *id, size_t size)
+{
+	static const char *const sources[] = {
+		"wwid", "device/wwid", "dm/uuid", "md/uuid", "serial",
+		"device/serial"
+	};
+	char path[PATH_MAX], real[PATH_MAX], part[16];
+	size_t i;
+
+	for (i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+		snprintf(path, sizeof(path), SYS_BLOCK "/%s/%s", name,
+			 sources[i]);
+		if (read_line(path, id, size))
+			return;
+	}
+
+	snprintf(path, sizeof(path), SYS_BLOCK "/%s/partition", name);
+	if (read_line(path, part, sizeof(part))) {
+		/* The disk is the parent directory */
+		snprintf(path, sizeof(path), SYS_BLOCK "/%s", name);
+		if (realpath(path, real)) {
+			char disk_id[FIELD_ID_KEY_SIZE];
+
+			device_id(basename(dirname(real)), disk_id,
+				  sizeof(disk_id));
+			snprintf(id, size, "%.100s-part%s", disk_id, part);
+			return;
+		}
+	}
+	snprintf(id, size, "%s", name);
+}
+
+static bool key_used(const struct dev *devs, const char *key)
+{
+	for (; devs; devs = devs->next)
+		if (!strcmp(devs->key, key))
+			return true;
+	return false;
+}
+
 int iostat(int argc, char **argv)
 {
 	/* TODO: char *include_only = getenv("include_only"); */
 	bool include_numbered = getenv("SHOW_NUMBERED") != NULL;	/* By default we want sda but not sda1 */
 
+	static struct field_ids ids;
 	FILE *f;
 	struct dev *devs = NULL, *devs_end = NULL;
 	unsigned dev_cnt = 0;
 	struct dev *dev;
 
+	field_ids_load(&ids, "iostat");
+
 	if (!(f = fopen(PROC_DISKSTAT, "r")))
 		return fail("cannot open " PROC_DISKSTAT);
 
 	while (!feof(f)) {
-		unsigned cnt = 0;
-		struct dev *d;
+		char id[FIELD_ID_KEY_SIZE];
 
 		dev = alloca(sizeof(*dev));
 		dev->next = NULL;
 
-		if (4 != fscanf(f, "%hhu %*u %" STR(NAME_SIZE)
+		if (3 != fscanf(f, "%*u %*u %" STR(NAME_SIZE)
 				"s %*u %*u %lu %*u %*u %*u %lu%*[^\n]",
-				&dev->major, dev->name, &dev->rsect,
-				&dev->wsect))
+				dev->name, &dev->rsect, &dev->wsect))
 			continue;
 
 		if (!include_numbered && is_numbered(dev))
@@ -78,11 +139,15 @@ int iostat(int argc, char **argv)
 		if (dev->rsect == 0 && dev->wsect == 0)
 			continue;
 
-		for (d = devs; d; d = d->next)
-			if (dev->major == d->major)
-				cnt++;
-		snprintf(dev->key, sizeof(dev->key), "dev%d_%u",
-			 dev->major, cnt);
+		device_id(dev->name, id, sizeof(id));
+		if (key_used(devs, field_id(&ids, id))) {
+			/* Shared with a device met before, a multipath
+			 * member or a twin USB serial: told by its name */
+			size_t len = strlen(id);
+
+			snprintf(id + len, sizeof(id) - len, "-%s", dev->name);
+		}
+		snprintf(dev->key, sizeof(dev->key), "%s", field_id(&ids, id));
 
 		dev_cnt++;
 		if (!devs) {
@@ -93,6 +158,7 @@ int iostat(int argc, char **argv)
 		}
 	}
 	fclose(f);
+	field_ids_save(&ids, "iostat");
 
 	if (argc > 1) {
 		if (!strcmp(argv[1], "config")) {
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Redis and memcached statistics over their text protocols.
+ *
+ * Environment:
+ *   instances  space separated list of [name=][redis:|memcached:]address
+ *              where address is host:port or a unix socket path. The type
+ *              defaults to the basename suffix (kvstats_redis...,
+ *              kvstats_memcached...).
+ *   timeout    in seconds for all the instances together, 5 by default
+ *
+ * All instances are connected to, sent their commands and read from at
+ * once, so the slow ones are waited for in parallel. */
+
+#include <ctype.h>
+#include <errno.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "plugins.h"
+#include "sock.h"
+#include "../probes.h"
+
+#define KV_BUFSIZE 32768
+#define MAX_INSTANCES 32
+#define NAME_SIZE 48
+
+enum kv_type { KV_UNKNOWN, KV_REDIS, KV_MEMCACHED };
+
+enum kv_step { KV_CONNECTING, KV_SENDING, KV_READING };
+
+struct instance {
+	enum kv_type type;
+	char name[NAME_SIZE];
+	const char *address;
+	int fd;
+	enum kv_step step;
+	size_t done;		/* bytes sent or received */
+	bool ok;
+	uint64_t ops, hits, misses, memory, evictions, connections;
+};
+
+/* The INFO/stats keys of each server, in struct instance order */
+static const struct kv_keys {
+	const char *ops;
+	const char *ops2;
+	const char *hits;
+	const char *misses;
+	const char *memory;
+	const char *evictions;
+	const char *connections;
+} kv_keys[] = {
+	[KV_REDIS] = {"total_commands_processed", NULL, "keyspace_hits",
+		      "keyspace_misses", "used_memory", "evicted_keys",
+		      "connected_clients"},
+	[KV_MEMCACHED] = {"cmd_get", "cmd_set", "get_hits", "get_misses",
+			  "bytes", "evictions", "curr_connections"},
+};
+
+/* QUIT makes both servers close the connection once the stats are sent,
+ * so the end of the response is simply EOF. */
+static const char *const kv_commands[] = {
+	[KV_REDIS] = "INFO\r\nQUIT\r\n",
+	[KV_MEMCACHED] = "stats\r\nquit\r\n",
+};
+
+static const char *const kv_names[] = {
+	[KV_REDIS] = "redis",
+	[KV_MEMCACHED] = "memcached",
+};
+
+/* The type whose name s starts with, so that kvstats_redis_main works */
+static enum kv_type parse_type(const char *s)
+{
+	if (!strncmp(s, kv_names[KV_REDIS], strlen(kv_names[KV_REDIS])))
+		return KV_REDIS;
+	if (!strncmp(s, kv_names[KV_MEMCACHED],
+		     strlen(kv_names[KV_MEMCACHED])))
+		return KV_MEMCACHED;
+	return KV_UNKNOWN;
+}
+
+static int parse_instances(char *spec, enum kv_type default_type,
+			   struct instance *inst)
+{
+	char *tok, *eq, *colon;
+	enum kv_type type;
+	int nb = 0;
+
+	for (tok = strtok(spec, " \t"); tok; tok = strtok(NULL, " \t")) {
+		struct instance *i = inst + nb;
+
+		if (nb == MAX_INSTANCES) {
+			fail("too many instances");
+			return -1;
+		}
+		memset(i, 0, sizeof(*i));
+		i->fd = -1;
+
+		if ((eq = strchr(tok, '='))) {
+			*eq = '\0';
+			snprintf(i->name, sizeof(i->name), "%s", tok);
+			tok = eq + 1;
+		}
+		/* An exact type before the colon, redis01:6379 is a host */
+		i->type = default_type;
+		if ((colon = strchr(tok, ':'))
+		    && (type = parse_type(tok)) != KV_UNKNOWN
+		    && (size_t) (colon - tok) == strlen(kv_names[type])) {
+			i->type = type;
+			tok = colon + 1;
+		}
+		if (i->type == KV_UNKNOWN) {
+			fail("unknown type, use redis: or memcached:");
+			return -1;
+		}
+		i->address = tok;
+		if (!eq)
+			snprintf(i->name, sizeof(i->name), "%s", tok);
+		clean_fieldname(i->name);
+		nb++;
+	}
+	return nb;
+}
+
+static void store(struct instance *i, const char *key, const char *value)
+{
+	const struct kv_keys *k = &kv_keys[i->type];
+	uint64_t v;
+
+	if (!value)
+		return;
+	v = strtoull(value, NULL, 10);
+	if (!strcmp(key, k->ops) || (k->ops2 && !strcmp(key, k->ops2)))
+		i->ops += v;
+	else if (!strcmp(key, k->hits))
+		i->hits = v;
+	else if (!strcmp(key, k->misses))
+		i->misses = v;
+	else if (!strcmp(key, k->memory))
+		i->memory = v;
+	else if (!strcmp(key, k->evictions))
+		i->evictions = v;
+	else if (!strcmp(key, k->connections))
+		i->connections = v;
+}
+
+static void parse_response(struct instance *i, char *buf)
+{
+	char sep = i->type == KV_REDIS ? ':' : ' ';
+	char *key, *value, *s;
+
+	while (kv_next(&buf, sep, &key, &value)) {
+		if (i->type == KV_REDIS) {
+			/* "$1234" bulk header, "# Section" and "+OK" */
+			store(i, key, value);
+			continue;
+		}
+		/* STAT <key> <value> */
+		if (strcmp(key, "STAT") || !value
+		    || !(s = strchr(value, ' ')))
+			continue;
+		*s++ = '\0';
+		store(i, value, s);
+	}
+	i->ok = true;
+}
+
+/* Move an instance forward once its socket is ready */
+static void step(struct instance *i, char *buf)
+{
+	const char *cmd = kv_commands[i->type];
+	ssize_t n;
+
+	switch (i->step) {
+	case KV_CONNECTING:
+		if (sock_connected(i->fd) < 0)
+			break;
+		i->step = KV_SENDING;
+		/* FALLTHROUGH */
+	case KV_SENDING:
+		n = send(i->fd, cmd + i->done, strlen(cmd) - i->done,
+			 MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				return;
+			break;
+		}
+		i->done += n;
+		if (i->done == strlen(cmd)) {
+			i->step = KV_READING;
+			i->done = 0;
+		}
+		return;
+	case KV_READING:
+		n = recv(i->fd, buf + i->done, KV_BUFSIZE - 1 - i->done, 0);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+		if (n < 0)
+			break;
+		i->done += n;
+		if (n > 0 && i->done + 1 < KV_BUFSIZE)
+			return;
+		/* EOF, or as much as we keep */
+		buf[i->done] = '\0';
+		parse_response(i, buf);
+		break;
+	}
+	close(i->fd);
+	i->fd = -1;
+}
+
+/* Every instance is connected to, sent its command and read from in a
+ * single poll loop, so that a blackholed one only delays itself */
+static void query_all(struct instance *inst, int nb)
+{
+	static char bufs[MAX_INSTANCES][KV_BUFSIZE];
+	struct pollfd pfds[MAX_INSTANCES];
+	struct instance *polled[MAX_INSTANCES];
+	long long deadline, left;
+	int n, nb_polled;
+
+	PROBE1(source__read__start, "kvstats");
+	deadline = sock_now_ms() + 1000LL * getenvint("timeout", 5);
+
+	for (n = 0; n < nb; n++) {
+		struct instance *i = inst + n;
+
+		i->fd = sock_connect_start(i->address,
+					   i->type == KV_REDIS ?
+					   "6379" : "11211");
+		i->step = KV_CONNECTING;
+		i->done = 0;
+	}
+
+	for (;;) {
+		nb_polled = 0;
+		for (n = 0; n < nb; n++) {
+			if (inst[n].fd < 0)
+				continue;
+			pfds[nb_polled].fd = inst[n].fd;
+			pfds[nb_polled].events = inst[n].step == KV_READING ?
+			    POLLIN : POLLOUT;
+			polled[nb_polled++] = inst + n;
+		}
+		left = deadline - sock_now_ms();
+		if (nb_polled == 0 || left <= 0)
+			break;
+		if (poll(pfds, nb_polled, (int) left) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (n = 0; n < nb_polled; n++)
+			if (pfds[n].revents)
+				step(polled[n], bufs[polled[n] - inst]);
+	}
+
+	/* Those left have timed out */
+	for (n = 0; n < nb; n++)
+		if (inst[n].fd >= 0) {
+			close(inst[n].fd);
+			inst[n].fd = -1;
+		}
+	PROBE2(source__read__end, "kvstats", nb);
+}
+
+static const struct kv_graph {
+	const char *name;
+	const char *title;
+	const char *vlabel;
+	const char *args;
+	bool derive;
+	size_t offset;
+} kv_graphs[] = {
+	{"ops", "operations", "operations per ${graph_period}",
+	 "--base 1000 -l 0", true, offsetof(struct instance, ops)},
+	{"memory", "memory usage", "bytes", "--base 1024 -l 0", false,
+	 offsetof(struct instance, memory)},
+	{"evictions", "evictions", "evictions per ${graph_period}",
+	 "--base 1000 -l 0", true, offsetof(struct instance, evictions)},
+	{"connections", "connections", "connections", "--base 1000 -l 0",
+	 false, offsetof(struct instance, connections)},
+	{NULL, NULL, NULL, NULL, false, 0}
+};
+
+#define INST_VALUE(i, off) (*(const uint64_t *) ((const char *) (i) + (off)))
+
+static void print_config(const char *prefix, const struct instance *inst,
+			 int nb)
+{
+	const struct kv_graph *g;
+	int n;
+
+	for (g = kv_graphs; g->name; g++) {
+		printf("multigraph %s_%s\n"
+		       "graph_title Cache %s\n"
+		       "graph_args %s\n"
+		       "graph_vlabel %s\n"
+		       "graph_category cache\n", prefix, g->name, g->title,
+		       g->args, g->vlabel);
+		for (n = 0; n < nb; n++) {
+			printf("%s.label %s\n", inst[n].name,
+			       inst[n].address);
+			if (g->derive)
+				printf("%s.type DERIVE\n%s.min 0\n",
+				       inst[n].name, inst[n].name);
+		}
+	}
+
+	/* The ratio is computed on the rates, not on the counters since
+	 * startup, by turning the hits into the ratio with a cdef. */
+	printf("multigraph %s_hitratio\n"
+	       "graph_title Cache hit ratio\n"
+	       "graph_args --base 1000 -l 0 -u 100 -r\n"
+	       "graph_vlabel %%\n"
+	       "graph_scale no\n" "graph_category cache\n", prefix);
+	for (n = 0; n < nb; n++) {
+		const char *f = inst[n].name;
+		char field[NAME_SIZE + 8];
+
+		printf("%s_misses.label %s misses\n%s_misses.type DERIVE\n"
+		       "%s_misses.min 0\n%s_misses.graph no\n", f, f, f, f,
+		       f);
+		printf("%s_hits.label %s\n%s_hits.type DERIVE\n"
+		       "%s_hits.min 0\n%s_hits.cdef %s_hits,100,*,%s_hits,"
+		       "%s_misses,+,/\n", f, inst[n].address, f, f, f, f, f,
+		       f);
+		snprintf(field, sizeof(field), "%s_hits", f);
+		print_warncrit(field);
+	}
+}
+
+static void print_fetch(const char *prefix, const struct instance *inst,
+			int nb)
+{
+	const struct kv_graph *g;
+	int n;
+
+	for (g = kv_graphs; g->name; g++) {
+		printf("multigraph %s_%s\n", prefix, g->name);
+		for (n = 0; n < nb; n++) {
+			if (inst[n].ok)
+				printf("%s.value %" PRIu64 "\n",
+				       inst[n].name,
+				       INST_VALUE(inst + n, g->offset));
+			else
+				printf("%s.value U\n", inst[n].name);
+		}
+	}
+
+	printf("multigraph %s_hitratio\n", prefix);
+	for (n = 0; n < nb; n++) {
+		if (inst[n].ok)
+			printf("%s_hits.value %" PRIu64 "\n"
+			       "%s_misses.value %" PRIu64 "\n",
+			       inst[n].name, inst[n].hits, inst[n].name,
+			       inst[n].misses);
+		else
+			printf("%s_hits.value U\n%s_misses.value U\n",
+			       inst[n].name, inst[n].name);
+	}
+}
+
+int kvstats_(int argc, char **argv)
+{
+	struct instance inst[MAX_INSTANCES];
+	char *prefix, *spec;
+	int nb, n;
+
+	prefix = basename(argv[0]);
+	if (strncmp(prefix, "kvstats_", 8) != 0)
+		return fail("kvstats_ invoked with invalid basename");
+
+	if (!(spec = getenv("instances"))) {
+		if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+			puts("no (env.instances is not set)");
+			return 0;
+		}
+		return fail("env.instances is not set");
+	}
+	if ((nb = parse_instances(spec, parse_type(prefix + 8), inst)) <= 0)
+		return nb < 0 ? 1 : fail("no instance configured");
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "config")) {
+			print_config(prefix, inst, nb);
+			return 0;
+		}
+		if (!strcmp(argv[1], "autoconf")) {
+			query_all(inst, nb);
+			for (n = 0; n < nb; n++)
+				if (!inst[n].ok) {
+					printf("no (cannot query %s)\n",
+					       inst[n].address);
+					return 0;
+				}
+			return writeyes();
+		}
+	}
+
+	query_all(inst, nb);
+	print_fetch(prefix, inst, nb);
+	return 0;
+}
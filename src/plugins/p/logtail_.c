@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Count the lines of a log file containing some fixed strings, scanning
+ * only what was appended since the previous run.
+ *
+ * Environment:
+ *   logfile          the file to follow
+ *   fields           space separated field names
+ *   <field>_pattern  the fixed string counted in <field>, defaults to the
+ *                    field name
+ *
+ * The inode and the offset reached are kept in the state file along with
+ * the counters. A different inode means the log was rotated: the rest of
+ * the old file is read from <logfile>.1 when it is still there, then the
+ * new one is scanned from its start. A file shorter than the offset was
+ * truncated and is rescanned from its start too. The first run only
+ * records the end of the file.
+ *
+ * All the patterns are matched in a single pass with an Aho-Corasick
+ * automaton, so the cost depends on the amount of new data only. */
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "common.h"
+#include "plugins.h"
+
+#define MAX_PATTERNS 64
+#define MAX_STATES 4096
+#define CHUNK_SIZE 65536
+
+struct pattern {
+	char name[48];
+	const char *text;
+	uint64_t count;
+};
+
+struct logtail_state {
+	uint64_t inode;
+	uint64_t offset;
+};
+
+/* As kept in the state file */
+#define LOGTAIL_STATE_VERSION 1
+
+struct logtail_record {
+	uint64_t inode;
+	uint64_t offset;
+	struct {
+		char name[48];
+		uint64_t count;
+	} counts[MAX_PATTERNS];
+};
+
+/* A complete DFA: goto transitions with the failure links folded in */
+struct automaton {
+	int nb_states;
+	uint16_t next[MAX_STATES][256];
+	uint64_t out[MAX_STATES];	/* bitmask of the patterns ending here */
+};
+
+static struct automaton ac;
+
+static int ac_build(const struct pattern *patterns, int nb)
+{
+	static uint16_t fail_link[MAX_STATES], queue[MAX_STATES];
+	int p, c, head = 0, tail = 0;
+
+	/* ac is only built once, and is still zeroed: only the rows of the
+	 * states actually used get touched. */
+	ac.nb_states = 1;
+
+	/* The trie, 0 meaning "no transition" at this point */
+	for (p = 0; p < nb; p++) {
+		const unsigned char *s = (const unsigned char *)
+		    patterns[p].text;
+		int state = 0;
+
+		for (; *s; s++) {
+			if (!ac.next[state][*s]) {
+				if (ac.nb_states == MAX_STATES)
+					return fail("patterns too long");
+				ac.next[state][*s] = ac.nb_states++;
+			}
+			state = ac.next[state][*s];
+		}
+		ac.out[state] |= UINT64_C(1) << p;
+	}
+
+	/* Breadth first, so that the failure state is always complete */
+	for (c = 0; c < 256; c++)
+		if (ac.next[0][c]) {
+			fail_link[ac.next[0][c]] = 0;
+			queue[tail++] = ac.next[0][c];
+		}
+	while (head < tail) {
+		int state = queue[head++];
+
+		ac.out[state] |= ac.out[fail_link[state]];
+		for (c = 0; c < 256; c++) {
+			int child = ac.next[state][c];
+			if (child) {
+				fail_link[child] =
+				    ac.next[fail_link[state]][c];
+				queue[tail++] = child;
+			} else {
+				ac.next[state][c] =
+				    ac.next[fail_link[state]][c];
+			}
+		}
+	}
+	return 0;
+}
+
+static void count_line(const char *line, size_t len,
+		       struct pattern *patterns)
+{
+	const unsigned char *s = (const unsigned char *) line;
+	const unsigned char *end = s + len;
+	uint64_t matched = 0;
+	int state = 0;
+
+	for (; s < end; s++) {
+		state = ac.next[state][*s];
+		matched |= ac.out[state];
+	}
+	/* Each pattern counts at most once per line */
+	for (; matched; matched &= matched - 1)
+		patterns[__builtin_ctzll(matched)].count++;
+}
+
+/* Scan complete lines from offset on, returning the offset reached */
+static uint64_t scan_file(int fd, uint64_t offset,
+			  struct pattern *patterns)
+{
+	static char buf[CHUNK_SIZE];
+	size_t used = 0;
+	ssize_t n;
+
+	while ((n = pread(fd, buf + used, sizeof(buf) - used,
+			  offset + used)) > 0) {
+		char *line = buf, *end = buf + used + n, *nl;
+
+		while ((nl = memchr(line, '\n', end - line))) {
+			count_line(line, nl - line, patterns);
+			line = nl + 1;
+		}
+		offset += line - buf;
+		used = end - line;
+		if (used == sizeof(buf)) {
+			/* A line longer than the buffer, count it in pieces */
+			count_line(buf, used, patterns);
+			offset += used;
+			used = 0;
+		} else {
+			memmove(buf, line, used);
+		}
+	}
+	/* An incomplete last line is left for the next run */
+	return offset;
+}
+
+static bool load_state(const char *plugin, struct logtail_state *st,
+		       struct pattern *patterns, int nb)
+{
+	static struct logtail_record rec;
+	int i, p;
+
+	if (state_load(plugin, LOGTAIL_STATE_VERSION, &rec, sizeof(rec)))
+		return false;
+	st->inode = rec.inode;
+	st->offset = rec.offset;
+	/* By name, the fields may have changed since */
+	for (i = 0; i < MAX_PATTERNS; i++)
+		for (p = 0; p < nb; p++)
+			if (!strcmp(patterns[p].name, rec.counts[i].name))
+				patterns[p].count = rec.counts[i].count;
+	return true;
+}
+
+static int save_state(const char *plugin, const struct logtail_state *st,
+		      const struct pattern *patterns, int nb)
+{
+	static struct logtail_record rec;
+	int p;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.inode = st->inode;
+	rec.offset = st->offset;
+	for (p = 0; p < nb; p++) {
+		strcpy(rec.counts[p].name, patterns[p].name);
+		rec.counts[p].count = patterns[p].count;
+	}
+	if (state_save(plugin, LOGTAIL_STATE_VERSION, &rec, sizeof(rec)))
+		return fail("cannot write state file");
+	return 0;
+}
+
+static int parse_patterns(struct pattern *patterns)
+{
+	char *fields, *tok;
+	int nb = 0;
+
+	if (!(fields = getenv("fields")))
+		return 0;
+	for (tok = strtok(fields, " \t"); tok; tok = strtok(NULL, " \t")) {
+		char env[64];
+		struct pattern *p = patterns + nb;
+
+		if (nb == MAX_PATTERNS) {
+			fail("too many fields");
+			return -1;
+		}
+		snprintf(p->name, sizeof(p->name), "%s", tok);
+		clean_fieldname(p->name);
+		snprintf(env, sizeof(env), "%s_pattern", tok);
+		p->text = getenv(env);
+		if (p->text == NULL)
+			p->text = tok;
+		if (*p->text == '\0') {
+			fail("empty pattern");
+			return -1;
+		}
+		p->count = 0;
+		nb++;
+	}
+	return nb;
+}
+
+static int logtail_fetch(const char *plugin, const char *logfile,
+			 struct pattern *patterns, int nb)
+{
+	struct logtail_state st = { 0, 0 };
+	struct stat sb;
+	bool known;
+	int fd, p;
+
+	if (ac_build(patterns, nb))
+		return 1;
+
+	known = load_state(plugin, &st, patterns, nb);
+
+	if ((fd = open(logfile, O_RDONLY | O_CLOEXEC)) < 0)
+		goto unknown;
+	if (fstat(fd, &sb) < 0) {
+		close(fd);
+		goto unknown;
+	}
+
+	if (!known) {
+		st.offset = sb.st_size;
+	} else if (st.inode != (uint64_t) sb.st_ino) {
+		/* Rotated, finish the old file if it can still be found */
+		char rotated[PATH_MAX];
+		struct stat rsb;
+		int rfd;
+
+		snprintf(rotated, sizeof(rotated), "%s.1", logfile);
+		if ((rfd = open(rotated, O_RDONLY | O_CLOEXEC)) >= 0) {
+			if (fstat(rfd, &rsb) == 0
+			    && (uint64_t) rsb.st_ino == st.inode
+			    && (uint64_t) rsb.st_size >= st.offset)
+				scan_file(rfd, st.offset, patterns);
+			close(rfd);
+		}
+		st.offset = 0;
+	} else if ((uint64_t) sb.st_size < st.offset) {
+		/* Truncated */
+		st.offset = 0;
+	}
+
+	st.inode = sb.st_ino;
+	if (known)
+		st.offset = scan_file(fd, st.offset, patterns);
+	close(fd);
+
+	if (save_state(plugin, &st, patterns, nb))
+		return 1;
+	for (p = 0; p < nb; p++)
+		printf("%s.value %" PRIu64 "\n", patterns[p].name,
+		       patterns[p].count);
+	return 0;
+
+      unknown:
+	/* Between rotation and reopening there may be no file */
+	for (p = 0; p < nb; p++)
+		printf("%s.value U\n", patterns[p].name);
+	return 0;
+}
+
+int logtail_(int argc, char **argv)
+{
+	static struct pattern patterns[MAX_PATTERNS];
+	const char *plugin, *logfile;
+	int nb, p;
+
+	plugin = basename(argv[0]);
+	if (strncmp(plugin, "logtail_", 8) != 0)
+		return fail("logtail_ invoked with invalid basename");
+
+	logfile = getenv("logfile");
+	nb = parse_patterns(patterns);
+	if (nb < 0)
+		return 1;
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf")) {
+			if (logfile == NULL || nb == 0) {
+				puts("no (env.logfile and env.fields needed)");
+				return 0;
+			}
+			return autoconf_check_readable(logfile);
+		}
+		if (!strcmp(argv[1], "config")) {
+			printf("graph_title Log lines in %s\n"
+			       "graph_args --base 1000 -l 0\n"
+			       "graph_vlabel lines per ${graph_period}\n"
+			       "graph_category other\n"
+			       "graph_info Lines of %s containing each "
+			       "pattern.\n", plugin + 8,
+			       logfile ? logfile : "?");
+			for (p = 0; p < nb; p++) {
+				printf("%s.label %s\n", patterns[p].name,
+				       patterns[p].name);
+				printf("%s.info Lines containing \"%s\"\n",
+				       patterns[p].name, patterns[p].text);
+				printf("%s.type DERIVE\n%s.min 0\n",
+				       patterns[p].name, patterns[p].name);
+				print_warncrit(patterns[p].name);
+			}
+			return 0;
+		}
+	}
+
+	if (logfile == NULL)
+		return fail("env.logfile is not set");
+	if (nb == 0)
+		return fail("env.fields is not set");
+	return logtail_fetch(plugin, logfile, patterns, nb);
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Size of the neighbour (ARP/ND) and routing tables, so that a
+ * "neighbour table overflow" can be seen coming.
+ *
+ * Both tables are streamed with RTM_GETNEIGH/RTM_GETROUTE dumps whose
+ * callbacks only increment counters: memory use does not depend on the
+ * size of the tables. The neighbour totals get the gc_thresh2 (soft) and
+ * gc_thresh3 (hard) limits of the kernel as warning and critical levels. */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "plugins.h"
+
+#ifndef HAVE_LINUX_RTNETLINK_H
+int neigh_route(int argc, char **argv)
+{
+	if (argc && argv) {
+		/* Do nothing, but silence the warnings */
+	}
+	return fail("rtnetlink is not supported on your system");
+}
+#else
+
+#include <linux/neighbour.h>
+#include "netlink.h"
+
+#define GC_THRESH_FMT "/proc/sys/net/%s/neigh/default/gc_thresh%d"
+
+/* Distinct routing tables tracked, the rest is summed up as "other" */
+#define MAX_TABLES 32
+
+enum { FAM_IPV4, FAM_IPV6, FAM_NB };
+
+static const struct {
+	const char *name;
+	const char *sysctl;
+	int af;
+} families[FAM_NB] = {
+	{"ipv4", "ipv4", AF_INET},
+	{"ipv6", "ipv6", AF_INET6},
+};
+
+static const struct {
+	uint16_t state;
+	const char *name;
+	const char *info;
+} neigh_states[] = {
+	{NUD_REACHABLE, "reachable", "Confirmed reachable recently."},
+	{NUD_STALE, "stale", "Not confirmed recently, still usable."},
+	{NUD_DELAY, "delay", "Waiting a bit before probing."},
+	{NUD_PROBE, "probe", "Being probed."},
+	{NUD_INCOMPLETE, "incomplete", "Address resolution in progress."},
+	{NUD_FAILED, "failed", "Address resolution failed."},
+	{NUD_NOARP, "noarp", "No resolution needed."},
+	{NUD_PERMANENT, "permanent", "Static entries."},
+	{0, NULL, NULL}
+};
+
+#define NB_STATES (sizeof(neigh_states) / sizeof(*neigh_states) - 1)
+
+struct table_count {
+	uint32_t id;
+	uint64_t count[FAM_NB];
+};
+
+struct counts {
+	uint64_t neigh[FAM_NB][NB_STATES + 1];	/* last one is "other" */
+	struct table_count tables[MAX_TABLES];
+	size_t tables_nb;
+	uint64_t other_tables[FAM_NB];
+};
+
+static int family_index(int af)
+{
+	int i;
+	for (i = 0; i < FAM_NB; i++)
+		if (families[i].af == af)
+			return i;
+	return -1;
+}
+
+static int neigh_cb(const struct nlmsghdr *h, void *data)
+{
+	struct counts *c = data;
+	const struct ndmsg *ndm = NLMSG_DATA(h);
+	size_t i;
+	int fam;
+
+	if (h->nlmsg_type != RTM_NEWNEIGH ||
+	    h->nlmsg_len < NLMSG_LENGTH(sizeof(*ndm)))
+		return 0;
+	if ((fam = family_index(ndm->ndm_family)) < 0)
+		return 0;
+
+	for (i = 0; i < NB_STATES; i++)
+		if (ndm->ndm_state & neigh_states[i].state)
+			break;
+	c->neigh[fam][i]++;
+	return 0;
+}
+
+static int route_cb(const struct nlmsghdr *h, void *data)
+{
+	struct counts *c = data;
+	struct rtmsg *rtm = NLMSG_DATA(h);
+	struct rtattr *tb[RTA_MAX + 1];
+	uint32_t table;
+	size_t i;
+	int fam;
+
+	if (h->nlmsg_type != RTM_NEWROUTE ||
+	    h->nlmsg_len < NLMSG_LENGTH(sizeof(*rtm)))
+		return 0;
+	if (rtm->rtm_flags & RTM_F_CLONED)
+		return 0;
+	if ((fam = family_index(rtm->rtm_family)) < 0)
+		return 0;
+
+	table = rtm->rtm_table;
+	nl_parse_attrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(h));
+	if (tb[RTA_TABLE])
+		nl_attr_copy(&table, sizeof(table), tb[RTA_TABLE]);
+
+	for (i = 0; i < c->tables_nb; i++)
+		if (c->tables[i].id == table)
+			break;
+	if (i == c->tables_nb) {
+		if (i == MAX_TABLES) {
+			c->other_tables[fam]++;
+			return 0;
+		}
+		c->tables[i].id = table;
+		c->tables_nb++;
+	}
+	c->tables[i].count[fam]++;
+	return 0;
+}
+
+static int dump_tables(struct counts *c)
+{
+	struct {
+		struct nlmsghdr h;
+		union {
+			struct ndmsg ndm;
+			struct rtmsg rtm;
+		} u;
+	} req;
+	int fd, ret;
+
+	if ((fd = nl_open(NETLINK_ROUTE)) < 0)
+		return fail("cannot open rtnetlink socket");
+
+	memset(&req, 0, sizeof(req));
+	req.h.nlmsg_len = NLMSG_LENGTH(sizeof(req.u.ndm));
+	req.h.nlmsg_type = RTM_GETNEIGH;
+	req.u.ndm.ndm_family = AF_UNSPEC;
+	ret = nl_dump(fd, &req.h, neigh_cb, c);
+
+	if (ret == 0) {
+		memset(&req, 0, sizeof(req));
+		req.h.nlmsg_len = NLMSG_LENGTH(sizeof(req.u.rtm));
+		req.h.nlmsg_type = RTM_GETROUTE;
+		req.u.rtm.rtm_family = AF_UNSPEC;
+		ret = nl_dump(fd, &req.h, route_cb, c);
+	}
+	close(fd);
+
+	if (ret != 0)
+		return fail("rtnetlink dump failed");
+	return 0;
+}
+
+static long read_gc_thresh(const char *family, int n)
+{
+	char path[128];
+	FILE *f;
+	long value;
+
+	snprintf(path, sizeof(path), GC_THRESH_FMT, family, n);
+	if (!(f = fopen(path, "r")))
+		return -1;
+	if (1 != fscanf(f, "%ld", &value))
+		value = -1;
+	fclose(f);
+	return value;
+}
+
+static void table_field(char *buf, size_t size, int fam, uint32_t id)
+{
+	switch (id) {
+	case RT_TABLE_MAIN:
+		snprintf(buf, size, "%s_main", families[fam].name);
+		break;
+	case RT_TABLE_LOCAL:
+		snprintf(buf, size, "%s_local", families[fam].name);
+		break;
+	case RT_TABLE_DEFAULT:
+		snprintf(buf, size, "%s_default", families[fam].name);
+		break;
+	default:
+		snprintf(buf, size, "%s_table%" PRIu32, families[fam].name,
+			 id);
+	}
+}
+
+static void print_config(const struct counts *c)
+{
+	char field[64];
+	size_t i;
+	int fam;
+
+	for (fam = 0; fam < FAM_NB; fam++) {
+		const char *f = families[fam].name;
+		long soft = read_gc_thresh(families[fam].sysctl, 2);
+		long hard = read_gc_thresh(families[fam].sysctl, 3);
+
+		printf("multigraph neigh_route_%s\n"
+		       "graph_title Neighbour table (%s)\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel entries\n"
+		       "graph_category network\n"
+		       "graph_info Entries of the %s neighbour table by "
+		       "state. The total is checked against gc_thresh2 and "
+		       "gc_thresh3.\n", f, f,
+		       fam == FAM_IPV4 ? "ARP" : "NDP");
+		for (i = 0; i < NB_STATES; i++)
+			printf("%s.label %s\n%s.draw %s\n%s.info %s\n",
+			       neigh_states[i].name, neigh_states[i].name,
+			       neigh_states[i].name,
+			       i ? "STACK" : "AREA", neigh_states[i].name,
+			       neigh_states[i].info);
+		puts("other.label other\nother.draw STACK\n"
+		     "total.label total\ntotal.draw LINE1\n"
+		     "total.info Total entries, the kernel starts dropping "
+		     "above gc_thresh3.");
+		if (getenv("total_warning") || getenv("warning"))
+			print_warning("total");
+		else if (soft > 0)
+			printf("total.warning %ld\n", soft);
+		if (getenv("total_critical") || getenv("critical"))
+			print_critical("total");
+		else if (hard > 0)
+			printf("total.critical %ld\n", hard);
+	}
+
+	puts("multigraph neigh_route_tables\n"
+	     "graph_title Routing tables\n"
+	     "graph_args --base 1000 -l 0\n"
+	     "graph_vlabel routes\n"
+	     "graph_category network\n"
+	     "graph_info Number of routes in each routing table.");
+	for (i = 0; i < c->tables_nb; i++)
+		for (fam = 0; fam < FAM_NB; fam++) {
+			table_field(field, sizeof(field), fam,
+				    c->tables[i].id);
+			printf("%s.label %s\n", field, field);
+			print_warncrit(field);
+		}
+	if (c->tables_nb == MAX_TABLES)
+		for (fam = 0; fam < FAM_NB; fam++)
+			printf("%s_other.label %s other tables\n",
+			       families[fam].name, families[fam].name);
+}
+
+static void print_fetch(const struct counts *c)
+{
+	char field[64];
+	size_t i;
+	int fam;
+
+	for (fam = 0; fam < FAM_NB; fam++) {
+		uint64_t total = 0;
+
+		printf("multigraph neigh_route_%s\n", families[fam].name);
+		for (i = 0; i < NB_STATES; i++) {
+			printf("%s.value %" PRIu64 "\n",
+			       neigh_states[i].name, c->neigh[fam][i]);
+			total += c->neigh[fam][i];
+		}
+		total += c->neigh[fam][NB_STATES];
+		printf("other.value %" PRIu64 "\n", c->neigh[fam][NB_STATES]);
+		printf("total.value %" PRIu64 "\n", total);
+	}
+
+	puts("multigraph neigh_route_tables");
+	for (i = 0; i < c->tables_nb; i++)
+		for (fam = 0; fam < FAM_NB; fam++) {
+			table_field(field, sizeof(field), fam,
+				    c->tables[i].id);
+			printf("%s.value %" PRIu64 "\n", field,
+			       c->tables[i].count[fam]);
+		}
+	if (c->tables_nb == MAX_TABLES)
+		for (fam = 0; fam < FAM_NB; fam++)
+			printf("%s_other.value %" PRIu64 "\n",
+			       families[fam].name, c->other_tables[fam]);
+}
+
+int neigh_route(int argc, char **argv)
+{
+	struct counts c;
+
+	if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+		int fd = nl_open(NETLINK_ROUTE);
+		if (fd < 0) {
+			puts("no (cannot open rtnetlink socket)");
+			return 0;
+		}
+		close(fd);
+		return writeyes();
+	}
+
+	memset(&c, 0, sizeof(c));
+	if (dump_tables(&c))
+		return 1;
+
+	if (argc > 1 && !strcmp(argv[1], "config"))
+		print_config(&c);
+	else
+		print_fetch(&c);
+	return 0;
+}
+#endif
@@ -0,0 +1,533 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Round trip times and packet loss like ping_, without forking ping: the
+ * probes of all the hosts are in flight together from a single loop, so a
+ * run takes a single timeout whatever the number of hosts.
+ *
+ * Probes are ICMP echo requests over the unprivileged datagram sockets
+ * allowed by net.ipv4.ping_group_range, or else TCP connections, a refused
+ * connection counting as an answer. The plugin is linked as ping_<host>,
+ * or tcpping_<host> to always probe with TCP. With a single host the
+ * output is the one of the Perl ping_, with more a multigraph.
+ *
+ * Environment:
+ *   hosts     more hosts, separated by spaces
+ *   packets   probes per host, 3 by default
+ *   interval  milliseconds between the probes of a host, 200 by default
+ *   timeout   seconds to wait for the last answers, 2 by default
+ *   method    icmp, tcp or auto, the default
+ *   port      the port of TCP probes, 80 by default */
+
+#include <ctype.h>
+#include <errno.h>
+#include <libgen.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/icmp6.h>
+#include <netinet/ip_icmp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "plugins.h"
+
+#define HOSTS_MAX 1024
+#define PACKETS_MAX 20
+#define PAYLOAD_SIZE 16
+
+struct host {
+	char *name;
+	char field[64];
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	bool tcp;
+	bool resolved;
+	long long sent[PACKETS_MAX];	/* us, 0 if not sent or lost */
+	long long rtt[PACKETS_MAX];	/* us, -1 without an answer */
+	int fds[PACKETS_MAX];		/* connecting TCP probes */
+};
+
+static struct host hosts[HOSTS_MAX];
+static size_t nb_hosts;
+static int packets;
+static const char *port;
+/* The ICMP sockets for IPv4 and IPv6, -1 when not allowed */
+static int icmp_fds[2] = { -1, -1 };
+
+static long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int family_index(int family)
+{
+	return family == AF_INET6;
+}
+
+static bool field_taken(const char *field)
+{
+	size_t i;
+
+	for (i = 0; i < nb_hosts; i++)
+		if (!strcmp(hosts[i].field, field))
+			return true;
+	return false;
+}
+
+/* A host given twice is probed once, and hosts whose names clean to the
+ * same field, such as a.b and a-b, get a numbered one */
+static void add_host(char *name)
+{
+	struct host *h = hosts + nb_hosts;
+	char field[sizeof(h->field) - 8];
+	size_t i;
+	int n;
+
+	if (nb_hosts == HOSTS_MAX)
+		return;
+	for (i = 0; i < nb_hosts; i++)
+		if (!strcmp(hosts[i].name, name))
+			return;
+	/* Keep the first digit of addresses, clean_fieldname() would not */
+	snprintf(field, sizeof(field), "%s%s", xisalpha(*name) ? "" : "_",
+		 name);
+	clean_fieldname(field);
+	memset(h, 0, sizeof(*h));
+	snprintf(h->field, sizeof(h->field), "%s", field);
+	for (n = 2; field_taken(h->field); n++)
+		snprintf(h->field, sizeof(h->field), "%s_%d", field, n);
+	nb_hosts++;
+	h->name = name;
+	for (i = 0; i < PACKETS_MAX; i++) {
+		h->rtt[i] = -1;
+		h->fds[i] = -1;
+	}
+}
+
+static void resolve(struct host *h, const char *method)
+{
+	struct addrinfo hints, *ai;
+	int *icmp;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(h->name, port, &hints, &ai) != 0) {
+		fprintf(stderr, "%s: unknown host\n", h->name);
+		return;
+	}
+	memcpy(&h->addr, ai->ai_addr, ai->ai_addrlen);
+	h->addr_len = ai->ai_addrlen;
+	freeaddrinfo(ai);
+	h->resolved = true;
+
+	h->tcp = !strcmp(method, "tcp");
+	if (h->tcp)
+		return;
+	icmp = icmp_fds + family_index(h->addr.ss_family);
+	if (*icmp < 0)
+		*icmp = socket(h->addr.ss_family,
+			       SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			       h->addr.ss_family == AF_INET6 ?
+			       IPPROTO_ICMPV6 : IPPROTO_ICMP);
+	if (*icmp >= 0)
+		return;
+	if (!strcmp(method, "icmp")) {
+		fprintf(stderr, "%s: ICMP sockets not allowed\n", h->name);
+		h->resolved = false;
+	}
+	h->tcp = true;
+}
+
+/* Every TCP probe of every host may be connecting at once, so raise the
+ * soft limit of open files as needed, up to the hard one.
+ * @returns 0 on success, -1 when the hard limit is too low */
+static int raise_nofile(void)
+{
+	struct rlimit rl;
+	rlim_t need = 16;
+	size_t i;
+
+	for (i = 0; i < nb_hosts; i++)
+		if (hosts[i].resolved && hosts[i].tcp)
+			need += packets;
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur >= need)
+		return 0;
+	if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < need)
+		return -1;
+	rl.rlim_cur = need;
+	return setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+/* Probe ids are the host and the probe, as ICMP sequence numbers */
+static void send_icmp(struct host *h, int probe)
+{
+	uint8_t packet[sizeof(struct icmphdr) + PAYLOAD_SIZE];
+	uint16_t seq = (h - hosts) * packets + probe;
+
+	memset(packet, 0, sizeof(packet));
+	if (h->addr.ss_family == AF_INET6) {
+		struct icmp6_hdr *icmp = (struct icmp6_hdr *) packet;
+
+		icmp->icmp6_type = ICMP6_ECHO_REQUEST;
+		icmp->icmp6_seq = htons(seq);
+	} else {
+		struct icmphdr *icmp = (struct icmphdr *) packet;
+
+		icmp->type = ICMP_ECHO;
+		icmp->un.echo.sequence = htons(seq);
+	}
+	/* The kernel fills the id and the checksum in */
+	if (sendto(icmp_fds[family_index(h->addr.ss_family)], packet,
+		   sizeof(packet), 0, (struct sockaddr *) &h->addr,
+		   h->addr_len) < 0)
+		h->sent[probe] = 0;
+}
+
+static void send_tcp(struct host *h, int probe)
+{
+	int fd = socket(h->addr.ss_family,
+			SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		h->sent[probe] = 0;
+		return;
+	}
+	if (connect(fd, (struct sockaddr *) &h->addr, h->addr_len) == 0
+	    || errno == ECONNREFUSED) {
+		h->rtt[probe] = now_us() - h->sent[probe];
+		close(fd);
+	} else if (errno == EINPROGRESS) {
+		h->fds[probe] = fd;
+	} else {
+		h->sent[probe] = 0;
+		close(fd);
+	}
+}
+
+static void send_probes(int probe)
+{
+	size_t i;
+
+	for (i = 0; i < nb_hosts; i++) {
+		struct host *h = hosts + i;
+
+		if (!h->resolved)
+			continue;
+		h->sent[probe] = now_us();
+		if (h->tcp)
+			send_tcp(h, probe);
+		else
+			send_icmp(h, probe);
+	}
+}
+
+static bool same_addr(const struct sockaddr_storage *a,
+		      const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family)
+		return false;
+	if (a->ss_family == AF_INET)
+		return ((const struct sockaddr_in *) a)->sin_addr.s_addr ==
+		    ((const struct sockaddr_in *) b)->sin_addr.s_addr;
+	return !memcmp(&((const struct sockaddr_in6 *) a)->sin6_addr,
+		       &((const struct sockaddr_in6 *) b)->sin6_addr,
+		       sizeof(struct in6_addr));
+}
+
+static void receive_icmp(int fd)
+{
+	uint8_t packet[1024];
+	struct sockaddr_storage from;
+	socklen_t from_len;
+	ssize_t len;
+
+	while (from_len = sizeof(from),
+	       (len = recvfrom(fd, packet, sizeof(packet), MSG_DONTWAIT,
+			       (struct sockaddr *) &from, &from_len)) >= 0) {
+		const struct icmphdr *icmp = (const void *) packet;
+		const struct icmp6_hdr *icmp6 = (const void *) packet;
+		unsigned int seq, probe;
+		struct host *h;
+
+		if ((size_t) len < sizeof(struct icmphdr))
+			continue;
+		if (from.ss_family == AF_INET6) {
+			if (icmp6->icmp6_type != ICMP6_ECHO_REPLY)
+				continue;
+			seq = ntohs(icmp6->icmp6_seq);
+		} else {
+			if (icmp->type != ICMP_ECHOREPLY)
+				continue;
+			seq = ntohs(icmp->un.echo.sequence);
+		}
+		if (seq >= nb_hosts * packets)
+			continue;
+		h = hosts + seq / packets;
+		probe = seq % packets;
+		if (!h->tcp && h->sent[probe] && h->rtt[probe] < 0
+		    && same_addr(&h->addr, &from))
+			h->rtt[probe] = now_us() - h->sent[probe];
+	}
+}
+
+static void finish_tcp(struct host *h, int probe)
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (getsockopt(h->fds[probe], SOL_SOCKET, SO_ERROR, &err, &len) == 0
+	    && (err == 0 || err == ECONNREFUSED))
+		h->rtt[probe] = now_us() - h->sent[probe];
+	else
+		h->sent[probe] = 0;	/* lost, no need to wait */
+	close(h->fds[probe]);
+	h->fds[probe] = -1;
+}
+
+/* Send the probes every interval, and wait for the answers */
+static void probe_all(long long interval, long long timeout)
+{
+	static struct pollfd pfds[2 + HOSTS_MAX * PACKETS_MAX];
+	static struct host *owners[2 + HOSTS_MAX * PACKETS_MAX];
+	static int probes[2 + HOSTS_MAX * PACKETS_MAX];
+	long long start = now_us(), deadline;
+	int next = 0, j;
+	size_t i;
+
+	deadline = start + (packets - 1) * interval + timeout;
+	for (;;) {
+		long long now = now_us(), wake = deadline;
+		size_t nfds = 0, pending = 0;
+
+		if (next < packets && now >= start + next * interval)
+			send_probes(next++);
+		if (next < packets)
+			wake = start + next * interval;
+
+		for (i = 0; i < 2; i++)
+			if (icmp_fds[i] >= 0) {
+				pfds[nfds].fd = icmp_fds[i];
+				pfds[nfds].events = POLLIN;
+				owners[nfds++] = NULL;
+			}
+		for (i = 0; i < nb_hosts; i++)
+			for (j = 0; j < next; j++) {
+				struct host *h = hosts + i;
+
+				if (h->sent[j] && h->rtt[j] < 0)
+					pending++;
+				if (h->fds[j] < 0)
+					continue;
+				pfds[nfds].fd = h->fds[j];
+				pfds[nfds].events = POLLOUT;
+				owners[nfds] = h;
+				probes[nfds++] = j;
+			}
+		if (now >= deadline || (next == packets && pending == 0))
+			break;
+
+		if (wake < now)
+			wake = now;
+		if (poll(pfds, nfds, (int) ((wake - now + 999) / 1000)) <= 0)
+			continue;
+		for (i = 0; i < nfds; i++) {
+			if (!pfds[i].revents)
+				continue;
+			if (owners[i])
+				finish_tcp(owners[i], probes[i]);
+			else
+				receive_icmp(pfds[i].fd);
+		}
+	}
+
+	for (i = 0; i < nb_hosts; i++)
+		for (j = 0; j < packets; j++)
+			if (hosts[i].fds[j] >= 0)
+				close(hosts[i].fds[j]);
+}
+
+struct stats {
+	double min, avg, max, loss;
+	int answers;
+};
+
+static void host_stats(const struct host *h, struct stats *st)
+{
+	double sum = 0;
+	int j;
+
+	memset(st, 0, sizeof(*st));
+	for (j = 0; j < packets; j++) {
+		double rtt = h->rtt[j] / 1e6;
+
+		if (h->rtt[j] < 0)
+			continue;
+		if (!st->answers || rtt < st->min)
+			st->min = rtt;
+		if (!st->answers || rtt > st->max)
+			st->max = rtt;
+		sum += rtt;
+		st->answers++;
+	}
+	if (st->answers)
+		st->avg = sum / st->answers;
+	st->loss = 100.0 * (packets - st->answers) / packets;
+}
+
+static void print_rtt(const char *field, double rtt, bool known)
+{
+	if (known)
+		printf("%s.value %.6f\n", field, rtt);
+	else
+		printf("%s.value U\n", field);
+}
+
+static void print_single_config(const struct host *h, bool tcp)
+{
+	printf("graph_title %s times to %s\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel roundtrip time (seconds)\n"
+	       "graph_category network\n"
+	       "graph_info This graph shows ping RTT statistics.\n"
+	       "ping.label %s\n"
+	       "ping.info Ping RTT statistics for %s.\n"
+	       "ping.draw LINE2\n"
+	       "packetloss.label packet loss\n"
+	       "packetloss.graph no\n", tcp ? "TCP connect" : "Ping",
+	       h->name, h->name, h->name);
+	print_warncrit("ping");
+}
+
+static void print_config(const char *prefix)
+{
+	size_t i;
+
+	printf("multigraph %s_rtt\n"
+	       "graph_title Round trip times\n"
+	       "graph_args --base 1000 -l 0\n"
+	       "graph_vlabel seconds\n"
+	       "graph_category network\n", prefix);
+	for (i = 0; i < nb_hosts; i++) {
+		printf("%s.label %s\n", hosts[i].field, hosts[i].name);
+		print_warncrit(hosts[i].field);
+	}
+	printf("multigraph %s_loss\n"
+	       "graph_title Packet loss\n"
+	       "graph_args --base 1000 -l 0 --upper-limit 100\n"
+	       "graph_vlabel %%\n"
+	       "graph_category network\n", prefix);
+	for (i = 0; i < nb_hosts; i++)
+		printf("%s.label %s\n", hosts[i].field, hosts[i].name);
+
+	for (i = 0; i < nb_hosts; i++)
+		printf("multigraph %s_rtt.%s\n"
+		       "graph_title Round trip time to %s\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel seconds\n"
+		       "graph_category network\n"
+		       "min.label min\n"
+		       "avg.label avg\n"
+		       "max.label max\n", prefix, hosts[i].field,
+		       hosts[i].name);
+}
+
+static void print_fetch(const char *prefix)
+{
+	struct stats st;
+	size_t i;
+
+	printf("multigraph %s_rtt\n", prefix);
+	for (i = 0; i < nb_hosts; i++) {
+		host_stats(hosts + i, &st);
+		print_rtt(hosts[i].field, st.avg, st.answers);
+	}
+	printf("multigraph %s_loss\n", prefix);
+	for (i = 0; i < nb_hosts; i++) {
+		host_stats(hosts + i, &st);
+		printf("%s.value %.1f\n", hosts[i].field, st.loss);
+	}
+	for (i = 0; i < nb_hosts; i++) {
+		host_stats(hosts + i, &st);
+		printf("multigraph %s_rtt.%s\n", prefix, hosts[i].field);
+		print_rtt("min", st.min, st.answers);
+		print_rtt("avg", st.avg, st.answers);
+		print_rtt("max", st.max, st.answers);
+	}
+}
+
+int ping_(int argc, char **argv)
+{
+	char *name, *host, *more, *s, prefix[64];
+	const char *method;
+	bool tcp;
+	size_t i;
+
+	name = basename(argv[0]);
+	tcp = !strncmp(name, "tcpping_", 8);
+	host = strchr(name, '_') + 1;
+	if (!(method = getenv("method")) || tcp)
+		method = tcp ? "tcp" : "auto";
+	if (!(port = getenv("port")))
+		port = "80";
+	packets = getenvint("packets", 3);
+	if (packets < 1 || packets > PACKETS_MAX)
+		return fail("packets out of range");
+
+	snprintf(prefix, sizeof(prefix), "%s", name);
+	clean_fieldname(prefix);
+	if ((s = strrchr(prefix, '_')) && s[1] == '\0')
+		*s = '\0';
+	if (*host)
+		add_host(host);
+	if ((more = getenv("hosts")) && (more = strdup(more)))
+		for (s = strtok(more, " \t"); s; s = strtok(NULL, " \t"))
+			add_host(s);
+	if (nb_hosts == 0)
+		return fail("no host given");
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf"))
+			return writeyes();
+		if (!strcmp(argv[1], "config")) {
+			if (nb_hosts == 1 && *host)
+				print_single_config(hosts, tcp);
+			else
+				print_config(prefix);
+			return 0;
+		}
+	}
+
+	for (i = 0; i < nb_hosts; i++)
+		resolve(hosts + i, method);
+	if (raise_nofile() < 0)
+		return fail("too many TCP probes for the open files limit");
+	probe_all(getenvint("interval", 200) * 1000LL,
+		  getenvint("timeout", 2) * 1000000LL);
+
+	if (nb_hosts == 1 && *host) {
+		struct stats st;
+
+		host_stats(hosts, &st);
+		print_rtt("ping", st.avg, st.answers);
+		printf("packetloss.value %.1f\n", st.loss);
+		return 0;
+	}
+	print_fetch(prefix);
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Number of processes by name, without forking pgrep.
+ *
+ * ps_<name> counts the processes called name, or matching env.pattern.
+ *
+ * ps_multi counts every group in a single /proc scan, see procmem_:
+ *   groups         space separated group names
+ *   <group>_match  space separated shell patterns, the group name by default
+ * It produces one graph with all the groups, where the warning and
+ * critical thresholds apply, and one per group below it.
+ *
+ * Both match comm, or the command line when env.match is "cmdline". */
+
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "plugins.h"
+#include "procscan.h"
+
+static void count_process(int pid, uint64_t groups, void *data)
+{
+	int *counts = data, i;
+
+	if (pid) {
+		/* Do nothing, but silence the warnings */
+	}
+	for (i = 0; groups; i++, groups >>= 1)
+		if (groups & 1)
+			counts[i]++;
+}
+
+static int ps_single(int argc, char **argv, const char *name)
+{
+	static struct proc_matcher matcher;
+	const char *pattern, *s;
+	int count = 0;
+
+	if (!*name)
+		return fail("ps_ needs a process name, e.g. ps_sshd");
+	if (!(pattern = getenv("pattern")))
+		pattern = name;
+	if ((s = getenv("match")))
+		matcher.cmdline = !strcmp(s, "cmdline");
+	proc_matcher_add(&matcher, pattern, 0);
+
+	if (argc > 1 && !strcmp(argv[1], "config")) {
+		printf("graph_title Number of %s processes\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel processes\n"
+		       "graph_category processes\n"
+		       "graph_info Processes whose %s matches %s.\n"
+		       "count.label %s\n"
+		       "count.draw LINE2\n", name,
+		       matcher.cmdline ? "command line" : "name", pattern,
+		       name);
+		print_warncrit("count");
+		return 0;
+	}
+
+	if (proc_scan(&matcher, count_process, &count) < 0)
+		return fail("cannot read /proc");
+	printf("count.value %d\n", count);
+	return 0;
+}
+
+static int ps_multi(int argc, char **argv, const char *plugin)
+{
+	static struct proc_group groups[PROC_MAX_GROUPS];
+	static struct proc_matcher matcher;
+	static int counts[PROC_MAX_GROUPS];
+	bool config = argc > 1 && !strcmp(argv[1], "config");
+	int nb, i;
+
+	if ((nb = proc_groups_env(groups, &matcher)) < 0)
+		return 1;
+	if (nb == 0)
+		return fail("env.groups is not set");
+	if (!config && proc_scan(&matcher, count_process, counts) < 0)
+		return fail("cannot read /proc");
+
+	printf("multigraph %s\n", plugin);
+	if (config)
+		printf("graph_title Number of processes per group\n"
+		       "graph_args --base 1000 -l 0\n"
+		       "graph_vlabel processes\n"
+		       "graph_category processes\n");
+	for (i = 0; i < nb; i++) {
+		if (config) {
+			printf("%s.label %s\n", groups[i].field,
+			       groups[i].label);
+			print_warncrit(groups[i].field);
+		} else {
+			printf("%s.value %d\n", groups[i].field, counts[i]);
+		}
+	}
+
+	for (i = 0; i < nb; i++) {
+		printf("multigraph %s.%s\n", plugin, groups[i].field);
+		if (config) {
+			printf("graph_title Number of %s processes\n"
+			       "graph_args --base 1000 -l 0\n"
+			       "graph_vlabel processes\n"
+			       "graph_category processes\n"
+			       "count.label %s\n"
+			       "count.draw LINE2\n", groups[i].label,
+			       groups[i].label);
+		} else {
+			printf("count.value %d\n", counts[i]);
+		}
+	}
+	return 0;
+}
+
+int ps_(int argc, char **argv)
+{
+	const char *plugin;
+
+	plugin = basename(argv[0]);
+	if (strncmp(plugin, "ps_", 3) != 0)
+		return fail("ps_ invoked with invalid basename");
+
+	if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+		if (access("/proc/self/comm", R_OK)) {
+			puts("no (/proc/self/comm not found)");
+			return 0;
+		}
+		return writeyes();
+	}
+	if (!strcmp(plugin, "ps_multi"))
+		return ps_multi(argc, argv, plugin);
+	return ps_single(argc, argv, plugin + 3);
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Traffic control queueing statistics, read with a single RTM_GETQDISC
+ * dump instead of forking "tc -s qdisc show".
+ *
+ * qdisc_<interface> graphs the qdiscs of one interface, a bare qdisc_
+ * graphs the qdiscs of every interface but lo. */
+
+#include <libgen.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include "common.h"
+#include "plugins.h"
+
+#ifndef HAVE_LINUX_RTNETLINK_H
+int qdisc_(int argc, char **argv)
+{
+	if (argc && argv) {
+		/* Do nothing, but silence the warnings */
+	}
+	return fail("rtnetlink is not supported on your system");
+}
+#else
+
+#include <linux/gen_stats.h>
+#include <linux/pkt_sched.h>
+#include "netlink.h"
+
+#define FIELD_SIZE 64
+
+struct qdisc {
+	struct qdisc *next;
+	char field[FIELD_SIZE];
+	char label[FIELD_SIZE];
+	uint64_t bytes;
+	uint64_t packets;
+	uint64_t drops;
+	uint64_t overlimits;
+	uint64_t requeues;
+	uint64_t backlog;
+	uint64_t qlen;
+};
+
+static const struct qdisc_graph {
+	const char *name;
+	const char *title;
+	const char *vlabel;
+	const char *type;
+	const char *info;
+	size_t offset;
+} qdisc_graphs[] = {
+	{"bytes", "Qdisc traffic", "bytes per ${graph_period}", "DERIVE",
+	 "Bytes dequeued by each qdisc.",
+	 offsetof(struct qdisc, bytes)},
+	{"packets", "Qdisc packets", "packets per ${graph_period}", "DERIVE",
+	 "Packets dequeued by each qdisc.",
+	 offsetof(struct qdisc, packets)},
+	{"drops", "Qdisc drops", "packets per ${graph_period}", "DERIVE",
+	 "Packets dropped by each qdisc, e.g. by a full queue or an AQM.",
+	 offsetof(struct qdisc, drops)},
+	{"overlimits", "Qdisc overlimits", "events per ${graph_period}",
+	 "DERIVE",
+	 "Times a qdisc delayed or dropped a packet for exceeding a rate.",
+	 offsetof(struct qdisc, overlimits)},
+	{"requeues", "Qdisc requeues", "packets per ${graph_period}",
+	 "DERIVE",
+	 "Packets put back into the queue because the driver was busy.",
+	 offsetof(struct qdisc, requeues)},
+	{"backlog", "Qdisc backlog", "bytes", "GAUGE",
+	 "Bytes currently waiting in each qdisc.",
+	 offsetof(struct qdisc, backlog)},
+	{"qlen", "Qdisc queue length", "packets", "GAUGE",
+	 "Packets currently waiting in each qdisc.",
+	 offsetof(struct qdisc, qlen)},
+	{NULL, NULL, NULL, NULL, NULL, 0}
+};
+
+struct qdisc_dump {
+	int ifindex;		/* 0 for all interfaces */
+	struct qdisc *head, **tail;
+};
+
+static int qdisc_cb(const struct nlmsghdr *h, void *data)
+{
+	struct qdisc_dump *dump = data;
+	struct tcmsg *tcm = NLMSG_DATA(h);
+	struct rtattr *tb[TCA_MAX + 1];
+	struct qdisc *q;
+	char ifname[IF_NAMESIZE];
+	const char *kind = "?";
+
+	if (h->nlmsg_type != RTM_NEWQDISC)
+		return 0;
+	if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*tcm)))
+		return 0;
+	if (dump->ifindex && tcm->tcm_ifindex != dump->ifindex)
+		return 0;
+	if (!if_indextoname(tcm->tcm_ifindex, ifname))
+		return 0;	/* interface vanished meanwhile */
+	if (!dump->ifindex && !strcmp(ifname, "lo"))
+		return 0;
+
+	nl_parse_attrs(tb, TCA_MAX, TCA_RTA(tcm), TCA_PAYLOAD(h));
+	if (tb[TCA_KIND])
+		kind = RTA_DATA(tb[TCA_KIND]);
+
+	if (!(q = calloc(1, sizeof(*q))))
+		return fail("out of memory");
+
+	if (tcm->tcm_handle || tcm->tcm_parent == TC_H_ROOT) {
+		snprintf(q->field, sizeof(q->field), "%s_%x_%x", ifname,
+			 TC_H_MAJ(tcm->tcm_handle) >> 16,
+			 TC_H_MIN(tcm->tcm_handle));
+		snprintf(q->label, sizeof(q->label), "%s %.16s %x:%s",
+			 ifname, kind, TC_H_MAJ(tcm->tcm_handle) >> 16,
+			 tcm->tcm_parent == TC_H_ROOT ? " root" : "");
+	} else {
+		/* The per queue children of mq all have the handle 0:0,
+		 * only their parents 1:1, 1:2... tell them apart */
+		snprintf(q->field, sizeof(q->field), "%s_0_%x_%x", ifname,
+			 TC_H_MAJ(tcm->tcm_parent) >> 16,
+			 TC_H_MIN(tcm->tcm_parent));
+		snprintf(q->label, sizeof(q->label), "%s %.16s parent %x:%x",
+			 ifname, kind, TC_H_MAJ(tcm->tcm_parent) >> 16,
+			 TC_H_MIN(tcm->tcm_parent));
+	}
+	clean_fieldname(q->field);
+
+	if (tb[TCA_STATS2]) {
+		struct rtattr *st[TCA_STATS_MAX + 1];
+		struct gnet_stats_basic basic;
+		struct gnet_stats_queue queue;
+
+		nl_parse_attrs(st, TCA_STATS_MAX, RTA_DATA(tb[TCA_STATS2]),
+			       RTA_PAYLOAD(tb[TCA_STATS2]));
+		if (st[TCA_STATS_BASIC]) {
+			nl_attr_copy(&basic, sizeof(basic),
+				     st[TCA_STATS_BASIC]);
+			q->bytes = basic.bytes;
+			q->packets = basic.packets;
+		}
+		if (st[TCA_STATS_QUEUE]) {
+			nl_attr_copy(&queue, sizeof(queue),
+				     st[TCA_STATS_QUEUE]);
+			q->drops = queue.drops;
+			q->overlimits = queue.overlimits;
+			q->requeues = queue.requeues;
+			q->backlog = queue.backlog;
+			q->qlen = queue.qlen;
+		}
+	} else if (tb[TCA_STATS]) {
+		/* Kernels older than 2.6.13 only have the legacy struct */
+		struct tc_stats st;
+
+		nl_attr_copy(&st, sizeof(st), tb[TCA_STATS]);
+		q->bytes = st.bytes;
+		q->packets = st.packets;
+		q->drops = st.drops;
+		q->overlimits = st.overlimits;
+		q->backlog = st.backlog;
+		q->qlen = st.qlen;
+	}
+
+	*dump->tail = q;
+	dump->tail = &q->next;
+	return 0;
+}
+
+static int qdisc_fetch_all(struct qdisc_dump *dump)
+{
+	struct {
+		struct nlmsghdr h;
+		struct tcmsg tcm;
+	} req;
+	int fd, ret;
+
+	if ((fd = nl_open(NETLINK_ROUTE)) < 0)
+		return fail("cannot open rtnetlink socket");
+
+	memset(&req, 0, sizeof(req));
+	req.h.nlmsg_len = NLMSG_LENGTH(sizeof(req.tcm));
+	req.h.nlmsg_type = RTM_GETQDISC;
+	req.tcm.tcm_family = AF_UNSPEC;
+	req.tcm.tcm_ifindex = dump->ifindex;
+
+	ret = nl_dump(fd, &req.h, qdisc_cb, dump);
+	close(fd);
+	if (ret < 0)
+		return fail("RTM_GETQDISC dump failed");
+	return ret;
+}
+
+static void print_graph_name(const char *prefix, const char *name)
+{
+	printf("multigraph %s_%s\n", prefix, name);
+}
+
+int qdisc_(int argc, char **argv)
+{
+	struct qdisc_dump dump;
+	const struct qdisc_graph *g;
+	const struct qdisc *q;
+	char *name, *interface, prefix[sizeof("qdisc_") + IF_NAMESIZE];
+	size_t len;
+
+	name = basename(argv[0]);
+	if (strncmp(name, "qdisc_", 6) != 0)
+		return fail("qdisc_ invoked with invalid basename");
+	interface = name + 6;
+
+	/* "qdisc_" gives qdisc_drops graphs, "qdisc_eth0.100" gives
+	 * qdisc_eth0_100_drops ones */
+	snprintf(prefix, sizeof(prefix), "%s", name);
+	len = strlen(prefix);
+	if (prefix[len - 1] == '_')
+		prefix[len - 1] = '\0';
+	clean_fieldname(prefix);
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf")) {
+			int fd = nl_open(NETLINK_ROUTE);
+			if (fd < 0) {
+				puts("no (cannot open rtnetlink socket)");
+				return 0;
+			}
+			close(fd);
+			return writeyes();
+		}
+		if (!strcmp(argv[1], "suggest")) {
+			struct if_nameindex *ifs, *i;
+			if (!(ifs = if_nameindex()))
+				return fail("cannot list interfaces");
+			for (i = ifs; i->if_index; i++)
+				if (strcmp(i->if_name, "lo"))
+					puts(i->if_name);
+			if_freenameindex(ifs);
+			return 0;
+		}
+	}
+
+	memset(&dump, 0, sizeof(dump));
+	dump.tail = &dump.head;
+	if (*interface && !(dump.ifindex = if_nametoindex(interface)))
+		return fail("unknown interface");
+	if (qdisc_fetch_all(&dump))
+		return 1;
+
+	if (argc > 1 && !strcmp(argv[1], "config")) {
+		for (g = qdisc_graphs; g->name; g++) {
+			print_graph_name(prefix, g->name);
+			printf("graph_title %s%s%s\n", g->title,
+			       *interface ? " on " : "", interface);
+			printf("graph_args --base 1000 -l 0\n"
+			       "graph_vlabel %s\n"
+			       "graph_category network\n"
+			       "graph_info %s\n", g->vlabel, g->info);
+			for (q = dump.head; q; q = q->next) {
+				printf("%s.label %s\n", q->field, q->label);
+				printf("%s.type %s\n", q->field, g->type);
+				printf("%s.min 0\n", q->field);
+				if (!strcmp(g->name, "drops"))
+					print_warncrit(q->field);
+			}
+		}
+		return 0;
+	}
+
+	for (g = qdisc_graphs; g->name; g++) {
+		print_graph_name(prefix, g->name);
+		for (q = dump.head; q; q = q->next)
+			printf("%s.value %" PRIu64 "\n", q->field,
+			       *(const uint64_t *) ((const char *) q +
+						    g->offset));
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,589 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Interface traffic of SNMP v2c agents from the 64-bit counters of
+ * ifXTable, like the Perl snmp__if_multi, but walking all the agents at
+ * once over a single UDP socket. Every column of the table is walked with
+ * its own GETBULK requests, all of them in flight together.
+ *
+ * The plugin is linked as snmp_<host>_if_multi. Environment:
+ *   community  the community, public by default
+ *   port       the port of the agents, 161 by default
+ *   hosts      more agents, as "host[:port]" separated by spaces
+ *   timeout    in seconds before a request is sent again, 1 by default
+ *   retries    times a request is sent again, 2 by default */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "plugins.h"
+#include "snmp.h"
+#include "sock.h"
+
+#define TARGETS_MAX 256
+#define IFACES_MAX 1024
+#define BULK_REPETITIONS 16
+#define NAME_MAX_LEN 64
+
+/* The columns of ifXTable we walk */
+enum column {
+	IF_NAME,
+	IF_IN_OCTETS,
+	IF_IN_PKTS,
+	IF_OUT_OCTETS,
+	IF_OUT_PKTS,
+	IF_SPEED,
+	IF_ALIAS,
+	NB_COLUMNS
+};
+
+static const uint32_t column_arcs[NB_COLUMNS] = { 1, 6, 7, 10, 11, 15, 18 };
+
+/* ifXEntry */
+static const struct snmp_oid ifx_entry = {
+	{1, 3, 6, 1, 2, 1, 31, 1, 1, 1}, 10
+};
+
+static const struct {
+	const char *suffix, *title, *vlabel, *label;
+	enum column in, out;
+	bool bits;
+} graphs[] = {
+	{"bytes", "Traffic", "bits in (-) / out (+) per ${graph_period}",
+	 "bps", IF_IN_OCTETS, IF_OUT_OCTETS, true},
+	{"packets", "Unicast packets",
+	 "packets in (-) / out (+) per ${graph_period}",
+	 "pps", IF_IN_PKTS, IF_OUT_PKTS, false},
+};
+
+#define NB_GRAPHS (sizeof(graphs) / sizeof(*graphs))
+
+struct iface {
+	uint32_t index;
+	char name[NAME_MAX_LEN];
+	char alias[NAME_MAX_LEN];
+	char field[NAME_MAX_LEN];
+	uint64_t values[NB_COLUMNS];
+	unsigned int have;	/* bit mask of the columns seen */
+};
+
+/* The walk of a column: one request in flight at a time */
+struct walk {
+	struct snmp_oid cursor;
+	int32_t request_id;
+	int tries;
+	long long sent_at;
+	bool done;
+};
+
+struct target {
+	const char *host;
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	struct walk walks[NB_COLUMNS];
+	struct iface *ifaces;
+	size_t nb_ifaces;
+	const char *error;
+	uint8_t seq;
+};
+
+static struct target targets[TARGETS_MAX];
+static size_t nb_targets;
+static struct snmp_oid columns[NB_COLUMNS];
+static const char *community;
+static long long timeout_ms;
+static int retries;
+static int sock;
+
+/* Request ids tell the target and the column they are for */
+static int32_t request_id(const struct target *t, enum column c)
+{
+	return (int32_t) ((t - targets) << 12 | c << 8 | t->seq);
+}
+
+static void target_fail(struct target *t, const char *error)
+{
+	size_t c;
+
+	if (!t->error)
+		t->error = error;
+	for (c = 0; c < NB_COLUMNS; c++)
+		t->walks[c].done = true;
+}
+
+static void send_request(struct target *t, enum column c)
+{
+	struct walk *w = t->walks + c;
+	struct snmp_varbind vb;
+	struct snmp_pdu pdu;
+	uint8_t buf[512];
+	ssize_t len;
+
+	memset(&vb, 0, sizeof(vb));
+	vb.oid = w->cursor;
+	vb.type = SNMP_NULL;
+	pdu.type = SNMP_GETBULK;
+	pdu.request_id = w->request_id;
+	pdu.error_status = 0;	/* non-repeaters */
+	pdu.error_index = BULK_REPETITIONS;
+	pdu.varbinds = &vb;
+	pdu.nb_varbinds = 1;
+
+	w->sent_at = sock_now_ms();
+	if ((len = snmp_encode(buf, sizeof(buf), community, &pdu)) < 0) {
+		target_fail(t, "request too long");
+		return;
+	}
+	/* A lost datagram is sent again on timeout */
+	sendto(sock, buf, len, 0, (struct sockaddr *) &t->addr, t->addr_len);
+}
+
+static void next_request(struct target *t, enum column c)
+{
+	t->seq++;
+	t->walks[c].request_id = request_id(t, c);
+	t->walks[c].tries = 0;
+	send_request(t, c);
+}
+
+static struct iface *find_iface(struct target *t, uint32_t index)
+{
+	struct iface *f;
+	size_t i;
+
+	for (i = 0; i < t->nb_ifaces; i++)
+		if (t->ifaces[i].index == index)
+			return t->ifaces + i;
+	if (t->nb_ifaces == IFACES_MAX)
+		return NULL;
+	f = realloc(t->ifaces, (t->nb_ifaces + 1) * sizeof(*f));
+	if (!f)
+		return NULL;
+	t->ifaces = f;
+	f += t->nb_ifaces++;
+	memset(f, 0, sizeof(*f));
+	f->index = index;
+	return f;
+}
+
+static void copy_string(char *dst, const struct snmp_varbind *vb)
+{
+	size_t i, n = 0;
+
+	for (i = 0; i < vb->str_len && n < NAME_MAX_LEN - 1; i++)
+		if (vb->str[i] >= ' ' && vb->str[i] < 0x7f)
+			dst[n++] = vb->str[i];
+	dst[n] = '\0';
+}
+
+static void store(struct target *t, enum column c,
+		  const struct snmp_varbind *vb)
+{
+	struct iface *f;
+
+	/* ifIndex is the single arc after the column */
+	if (vb->oid.len != columns[c].len + 1
+	    || !(f = find_iface(t, vb->oid.arcs[columns[c].len])))
+		return;
+	if (c == IF_NAME)
+		copy_string(f->name, vb);
+	else if (c == IF_ALIAS)
+		copy_string(f->alias, vb);
+	else if (vb->type != SNMP_OCTET_STRING)
+		f->values[c] = vb->num;
+	else
+		return;
+	f->have |= 1u << c;
+}
+
+static bool same_addr(const struct sockaddr_storage *a,
+		      const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family)
+		return false;
+	if (a->ss_family == AF_INET) {
+		const struct sockaddr_in *x = (const void *) a;
+		const struct sockaddr_in *y = (const void *) b;
+
+		return x->sin_port == y->sin_port
+		    && x->sin_addr.s_addr == y->sin_addr.s_addr;
+	} else {
+		const struct sockaddr_in6 *x = (const void *) a;
+		const struct sockaddr_in6 *y = (const void *) b;
+
+		return x->sin6_port == y->sin6_port
+		    && !memcmp(&x->sin6_addr, &y->sin6_addr,
+			       sizeof(x->sin6_addr));
+	}
+}
+
+static void handle_response(const uint8_t *buf, size_t len,
+			    const struct sockaddr_storage *from)
+{
+	static struct snmp_varbind vbs[BULK_REPETITIONS];
+	char name[64];
+	struct snmp_pdu pdu;
+	struct target *t;
+	struct walk *w;
+	size_t i, c;
+
+	pdu.varbinds = vbs;
+	pdu.nb_varbinds = BULK_REPETITIONS;
+	if (snmp_decode(buf, len, name, sizeof(name), &pdu) < 0
+	    || pdu.type != SNMP_RESPONSE || pdu.request_id < 0)
+		return;
+	i = pdu.request_id >> 12;
+	c = (pdu.request_id >> 8) & 0xf;
+	if (i >= nb_targets || c >= NB_COLUMNS)
+		return;
+	t = targets + i;
+	w = t->walks + c;
+	/* Late answers to a request sent again are dropped */
+	if (w->done || w->request_id != pdu.request_id
+	    || !same_addr(&t->addr, from))
+		return;
+	if (pdu.error_status) {
+		target_fail(t, "error status in response");
+		return;
+	}
+
+	for (i = 0; i < pdu.nb_varbinds; i++) {
+		const struct snmp_varbind *vb = vbs + i;
+
+		if (vb->type == SNMP_END_OF_MIB_VIEW
+		    || vb->type == SNMP_NO_SUCH_OBJECT
+		    || vb->type == SNMP_NO_SUCH_INSTANCE
+		    || !snmp_oid_has_prefix(&vb->oid, columns + c))
+			break;
+		if (snmp_oid_compare(&vb->oid, &w->cursor) <= 0) {
+			target_fail(t, "OID not increasing");
+			return;
+		}
+		w->cursor = vb->oid;
+		store(t, c, vb);
+	}
+	if (i < pdu.nb_varbinds || pdu.nb_varbinds == 0)
+		w->done = true;
+	else
+		next_request(t, c);
+}
+
+/* Send the requests again on timeout until every walk is done */
+static void walk_all(void)
+{
+	static uint8_t buf[SNMP_MSG_MAX];
+	size_t i, c;
+
+	for (i = 0; i < nb_targets; i++)
+		for (c = 0; c < NB_COLUMNS && !targets[i].error; c++)
+			next_request(targets + i, c);
+
+	for (;;) {
+		long long now = sock_now_ms(), next = -1;
+		struct pollfd pfd = { sock, POLLIN, 0 };
+
+		for (i = 0; i < nb_targets; i++)
+			for (c = 0; c < NB_COLUMNS; c++) {
+				struct target *t = targets + i;
+				struct walk *w = t->walks + c;
+
+				if (w->done)
+					continue;
+				if (now >= w->sent_at + timeout_ms) {
+					if (w->tries++ >= retries) {
+						target_fail(t, "timeout");
+						break;
+					}
+					send_request(t, c);
+				}
+				if (next < 0 || w->sent_at + timeout_ms < next)
+					next = w->sent_at + timeout_ms;
+			}
+		if (next < 0)
+			return;
+
+		if (poll(&pfd, 1, next > now ? (int) (next - now) : 0) <= 0)
+			continue;
+		for (;;) {
+			struct sockaddr_storage from;
+			socklen_t from_len = sizeof(from);
+			ssize_t len = recvfrom(sock, buf, sizeof(buf),
+					       MSG_DONTWAIT,
+					       (struct sockaddr *) &from,
+					       &from_len);
+
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len < 0)
+				break;
+			handle_response(buf, len, &from);
+		}
+	}
+}
+
+static void add_target(const char *host, int family, const char *port)
+{
+	struct target *t = targets + nb_targets;
+	struct addrinfo hints, *ai;
+	char name[NI_MAXHOST];
+	const char *colon = strrchr(host, ':'), *service = port;
+	size_t len = strlen(host), c;
+
+	if (nb_targets == TARGETS_MAX)
+		return;
+	nb_targets++;
+	memset(t, 0, sizeof(*t));
+	t->host = host;
+	for (c = 0; c < NB_COLUMNS; c++)
+		t->walks[c].cursor = columns[c];
+
+	/* host, host:port, [address] or [address]:port */
+	if (host[0] == '[' && (colon = strchr(host, ']'))) {
+		service = colon[1] == ':' ? colon + 2 : port;
+		host++;
+		len = colon - host;
+	} else if (colon && colon == strchr(host, ':')) {
+		service = colon + 1;
+		len = colon - host;
+	}
+	if (len == 0 || len >= sizeof(name)) {
+		target_fail(t, "invalid host");
+		return;
+	}
+	memcpy(name, host, len);
+	name[len] = '\0';
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = family == AF_INET6 ? AI_V4MAPPED : 0;
+	if (getaddrinfo(name, service, &hints, &ai) != 0) {
+		target_fail(t, "unknown host");
+		return;
+	}
+	memcpy(&t->addr, ai->ai_addr, ai->ai_addrlen);
+	t->addr_len = ai->ai_addrlen;
+	freeaddrinfo(ai);
+}
+
+/* One socket for all the agents, IPv4 ones being mapped if possible */
+static int open_socket(int *family)
+{
+	static const int no = 0, rcvbuf = 1 << 20;
+	int fd;
+
+	*family = AF_INET6;
+	fd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd >= 0 && setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &no,
+				  sizeof(no)) < 0) {
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0) {
+		*family = AF_INET;
+		fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	}
+	/* All the agents may answer at once */
+	if (fd >= 0)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	return fd;
+}
+
+/* Name the fields after the interfaces, or their index for duplicates */
+static void name_fields(struct target *t)
+{
+	size_t i, j;
+
+	for (i = 0; i < t->nb_ifaces; i++) {
+		struct iface *f = t->ifaces + i;
+
+		if (f->name[0] == '\0')
+			snprintf(f->name, sizeof(f->name), "if%" PRIu32,
+				 f->index);
+		snprintf(f->field, sizeof(f->field), "%s", f->name);
+		clean_fieldname(f->field);
+		for (j = 0; j < i; j++)
+			if (!strcmp(t->ifaces[j].field, f->field))
+				break;
+		if (j < i)
+			snprintf(f->field, sizeof(f->field), "if%" PRIu32,
+				 f->index);
+	}
+}
+
+static void print_fields(const char *field, const char *label, bool bits,
+			 uint64_t max)
+{
+	static const char *const dirs[] = { "down", "up" };
+	size_t i;
+
+	for (i = 0; i < 2; i++) {
+		printf("%s%s.label %s\n"
+		       "%s%s.type DERIVE\n"
+		       "%s%s.min 0\n", field, dirs[i], label,
+		       field, dirs[i], field, dirs[i]);
+		if (max)
+			printf("%s%s.max %" PRIu64 "\n", field, dirs[i], max);
+		if (bits)
+			printf("%s%s.cdef %s%s,8,*\n", field, dirs[i],
+			       field, dirs[i]);
+	}
+	printf("%sdown.graph no\n%sup.negative %sdown\n", field, field, field);
+}
+
+static void print_config(const struct target *t, const char *prefix)
+{
+	size_t g, i;
+
+	for (g = 0; g < NB_GRAPHS; g++) {
+		printf("multigraph %s_%s\n"
+		       "graph_title %s of %s\n"
+		       "graph_args --base 1000\n"
+		       "graph_vlabel %s\n"
+		       "graph_category network\n", prefix, graphs[g].suffix,
+		       graphs[g].title, t->host, graphs[g].vlabel);
+		for (i = 0; i < t->nb_ifaces; i++) {
+			char field[NAME_MAX_LEN + 1];
+
+			snprintf(field, sizeof(field), "%s_",
+				 t->ifaces[i].field);
+			print_fields(field, t->ifaces[i].name, graphs[g].bits,
+				     0);
+		}
+
+		for (i = 0; i < t->nb_ifaces; i++) {
+			const struct iface *f = t->ifaces + i;
+			/* ifHighSpeed is in Mbit/s, the counters in bytes */
+			uint64_t max = graphs[g].bits ?
+			    f->values[IF_SPEED] * 125000 : 0;
+
+			printf("multigraph %s_%s.%s\n"
+			       "graph_title %s of %s on %s\n"
+			       "graph_args --base 1000\n"
+			       "graph_vlabel %s\n"
+			       "graph_category network\n", prefix,
+			       graphs[g].suffix, f->field, graphs[g].title,
+			       f->name, t->host, graphs[g].vlabel);
+			if (f->alias[0])
+				printf("graph_info %s\n", f->alias);
+			print_fields("", graphs[g].label, graphs[g].bits, max);
+		}
+	}
+}
+
+static void print_value(const char *field, const char *dir,
+			const struct iface *f, enum column c)
+{
+	if (f->have & 1u << c)
+		printf("%s%s.value %" PRIu64 "\n", field, dir, f->values[c]);
+	else
+		printf("%s%s.value U\n", field, dir);
+}
+
+static void print_fetch(const struct target *t, const char *prefix)
+{
+	size_t g, i;
+
+	for (g = 0; g < NB_GRAPHS; g++) {
+		printf("multigraph %s_%s\n", prefix, graphs[g].suffix);
+		for (i = 0; i < t->nb_ifaces; i++) {
+			const struct iface *f = t->ifaces + i;
+			char field[NAME_MAX_LEN + 1];
+
+			snprintf(field, sizeof(field), "%s_", f->field);
+			print_value(field, "down", f, graphs[g].in);
+			print_value(field, "up", f, graphs[g].out);
+		}
+		for (i = 0; i < t->nb_ifaces; i++) {
+			const struct iface *f = t->ifaces + i;
+
+			printf("multigraph %s_%s.%s\n", prefix,
+			       graphs[g].suffix, f->field);
+			print_value("", "down", f, graphs[g].in);
+			print_value("", "up", f, graphs[g].out);
+		}
+	}
+}
+
+int snmp__if_multi(int argc, char **argv)
+{
+	char *name, *host, *hosts, *s;
+	const char *port;
+	size_t i, len, c, ok = 0;
+	bool config = argc > 1 && !strcmp(argv[1], "config");
+	int family;
+
+	if (argc > 1 && !strcmp(argv[1], "autoconf")) {
+		puts("no");
+		return 0;
+	}
+	name = basename(argv[0]);
+	len = strlen(name);
+	if (len < 14 || strncmp(name, "snmp_", 5)
+	    || strcmp(name + len - 9, "_if_multi"))
+		return fail("snmp__if_multi invoked with invalid basename");
+	name[len - 9] = '\0';
+	host = name + 5;
+
+	if (!(community = getenv("community")))
+		community = "public";
+	if (!(port = getenv("port")))
+		port = "161";
+	timeout_ms = getenvint("timeout", 1) * 1000LL;
+	retries = getenvint("retries", 2);
+	for (c = 0; c < NB_COLUMNS; c++) {
+		columns[c] = ifx_entry;
+		columns[c].arcs[columns[c].len++] = column_arcs[c];
+	}
+
+	if ((sock = open_socket(&family)) < 0)
+		return fail("cannot open socket");
+	if (*host)
+		add_target(host, family, port);
+	if ((hosts = getenv("hosts")) && (hosts = strdup(hosts)))
+		for (s = strtok(hosts, " \t"); s; s = strtok(NULL, " \t"))
+			add_target(s, family, port);
+	if (nb_targets == 0)
+		return fail("no host given");
+
+	walk_all();
+	close(sock);
+
+	/* Graphs of a single agent are for its own virtual host */
+	if (config && nb_targets == 1 && *host)
+		printf("host_name %s\n", host);
+	for (i = 0; i < nb_targets; i++) {
+		struct target *t = targets + i;
+		char prefix[NI_MAXHOST + 16];
+
+		if (t->error) {
+			fprintf(stderr, "%s: %s\n", t->host, t->error);
+			continue;
+		}
+		ok++;
+		name_fields(t);
+		snprintf(prefix, sizeof(prefix), "snmp_%s_if", t->host);
+		clean_fieldname(prefix);
+		if (config)
+			print_config(t, prefix);
+		else
+			print_fetch(t, prefix);
+	}
+	return ok ? 0 : fail("no agent answered");
+}
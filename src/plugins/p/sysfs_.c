@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+/* Values read from sysfs or procfs files, replacing one line shell plugins.
+ * procfs_ is the same plugin under another name.
+ *
+ * Environment:
+ *   fields           space separated field names
+ *   <field>_path     a path or shell glob; a glob matching several files
+ *                    gives a field per file, named after the path component
+ *                    holding the first wildcard (hwmon*, net/<*>...)
+ *   <field>_label    the label, the path by default
+ *   <field>_type     GAUGE by default
+ *   <field>_cdef     a cdef where the field name stands for each field
+ *   <field>_min, <field>_max
+ *   title, vlabel, category, args, info
+ *                    the graph attributes
+ *   acquire_interval seconds between two samples in acquire mode, 10 by
+ *                    default
+ *
+ * The globs are expanded and the files opened once, then every value is
+ * read with pread at offset 0, which sysfs and procfs files support.
+ *
+ * "acquire" keeps the files open and appends a sample of every field to
+ * the spool file ($MUNIN_SPOOLDIR/<plugin>, or <plugin>.spool in
+ * $MUNIN_PLUGSTATE) at each interval, until killed, under a flock() shared
+ * with the compaction of the spool by munin-node-c. */
+
+#include <fcntl.h>
+#include <glob.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "plugins.h"
+
+#define MAX_FIELDS 128
+#define FIELD_SIZE 64
+#define VALUE_SIZE 64
+
+struct sysfs_field {
+	const char *base;	/* the configured field name */
+	char name[FIELD_SIZE];
+	char path[PATH_MAX];
+	bool expanded;		/* one of several files matching a glob */
+	int fd;
+};
+
+/* Name a field after the component of path at the depth of the first
+ * wildcard in pattern. */
+static void expanded_name(char *name, size_t size, const char *base,
+			  const char *pattern, const char *path)
+{
+	size_t wild = strcspn(pattern, "*?["), len;
+	const char *s;
+	int depth = 0;
+
+	for (s = pattern; s < pattern + wild; s++)
+		if (*s == '/')
+			depth++;
+	for (s = path; depth > 0 && (s = strchr(s, '/')); depth--)
+		s++;
+	if (!s)
+		s = path;
+	len = strcspn(s, "/");
+	snprintf(name, size, "%s_%.*s", base, (int) len, s);
+	clean_fieldname(name);
+}
+
+static int expand_fields(struct sysfs_field *fields)
+{
+	char *names, *tok, env[FIELD_SIZE + 16];
+	const char *pattern;
+	int nb = 0;
+	size_t i, j;
+	glob_t g;
+
+	if (!(names = getenv("fields")))
+		return 0;
+	for (tok = strtok(names, " \t"); tok; tok = strtok(NULL, " \t")) {
+		snprintf(env, sizeof(env), "%s_path", tok);
+		if (!(pattern = getenv(env))) {
+			fail("a field has no _path");
+			return -1;
+		}
+		if (glob(pattern, 0, NULL, &g))
+			continue;	/* no such device here */
+		for (i = 0; i < g.gl_pathc; i++) {
+			struct sysfs_field *f = fields + nb;
+
+			if (nb == MAX_FIELDS) {
+				globfree(&g);
+				fail("too many fields");
+				return -1;
+			}
+			f->base = tok;
+			f->fd = -1;
+			snprintf(f->path, sizeof(f->path), "%s",
+				 g.gl_pathv[i]);
+			if (g.gl_pathc == 1) {
+				snprintf(f->name, sizeof(f->name), "%s", tok);
+				clean_fieldname(f->name);
+			} else {
+				expanded_name(f->name, sizeof(f->name), tok,
+					      pattern, g.gl_pathv[i]);
+				f->expanded = true;
+			}
+			/* Two files can share their first wildcard */
+			for (j = 0; j < (size_t) nb; j++)
+				if (!strcmp(fields[j].name, f->name)) {
+					snprintf(f->name, sizeof(f->name),
+						 "%s_%d", tok, nb);
+					clean_fieldname(f->name);
+				}
+			nb++;
+		}
+		globfree(&g);
+	}
+	return nb;
+}
+
+static void print_field_env(const struct sysfs_field *f, const char *attr)
+{
+	char env[FIELD_SIZE + 16];
+	const char *value;
+
+	snprintf(env, sizeof(env), "%s_%s", f->base, attr);
+	if ((value = getenv(env)))
+		printf("%s.%s %s\n", f->name, attr, value);
+}
+
+/* The cdef is given with the configured name, substitute each field's */
+static void print_cdef(const struct sysfs_field *f)
+{
+	char env[FIELD_SIZE + 16], cdef[LINE_MAX], *tok, *save;
+	const char *value;
+
+	snprintf(env, sizeof(env), "%s_cdef", f->base);
+	if (!(value = getenv(env)))
+		return;
+	snprintf(cdef, sizeof(cdef), "%s", value);
+	printf("%s.cdef ", f->name);
+	for (tok = strtok_r(cdef, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save))
+		printf("%s%s", tok == cdef ? "" : ",",
+		       strcmp(tok, f->base) ? tok : f->name);
+	putchar('\n');
+}
+
+static void print_config(const char *plugin, const struct sysfs_field *fields,
+			 int nb)
+{
+	const char *s;
+	char env[FIELD_SIZE + 16];
+	int i;
+
+	printf("graph_title %s\n", (s = getenv("title")) ? s : plugin);
+	printf("graph_args %s\n", (s = getenv("args")) ? s : "--base 1000");
+	printf("graph_category %s\n",
+	       (s = getenv("category")) ? s : "system");
+	if ((s = getenv("vlabel")))
+		printf("graph_vlabel %s\n", s);
+	if ((s = getenv("info")))
+		printf("graph_info %s\n", s);
+
+	for (i = 0; i < nb; i++) {
+		const struct sysfs_field *f = fields + i;
+
+		snprintf(env, sizeof(env), "%s_label", f->base);
+		if (!(s = getenv(env)))
+			printf("%s.label %s\n", f->name, f->path);
+		else if (f->expanded)
+			printf("%s.label %s (%s)\n", f->name, s, f->path);
+		else
+			printf("%s.label %s\n", f->name, s);
+		print_field_env(f, "type");
+		print_field_env(f, "min");
+		print_field_env(f, "max");
+		print_cdef(f);
+		print_warncrit(f->name);
+	}
+}
+
+/* Read the first word of a field's file, opening it on first use.
+ * @returns 0 on success, -1 on error */
+static int read_field(struct sysfs_field *f, char *value, size_t size)
+{
+	ssize_t len;
+	size_t word;
+
+	if (f->fd < 0 && (f->fd = open(f->path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	if ((len = pread(f->fd, value, size - 1, 0)) <= 0)
+		return -1;
+	value[len] = '\0';
+	word = strcspn(value, " \t\n");
+	if (word == 0)
+		return -1;
+	value[word] = '\0';
+	return 0;
+}
+
+/* Open the spool to append to it, locked against a compaction by the node,
+ * which may have renamed a new file over it while we waited */
+static FILE *open_spool(const char *path)
+{
+	struct stat locked, current;
+	FILE *spool;
+
+	for (;;) {
+		if (!(spool = fopen(path, "a")))
+			return NULL;
+		if (flock(fileno(spool), LOCK_EX) < 0
+		    || fstat(fileno(spool), &locked) < 0) {
+			fclose(spool);
+			return NULL;
+		}
+		if (stat(path, &current) == 0
+		    && current.st_ino == locked.st_ino
+		    && current.st_dev == locked.st_dev)
+			return spool;
+		fclose(spool);
+	}
+}
+
+static int acquire(const char *plugin, struct sysfs_field *fields, int nb)
+{
+	char path[PATH_MAX], value[VALUE_SIZE];
+	const char *dir;
+	FILE *spool;
+	int i, interval = getenvint("acquire_interval", 10);
+
+	if ((dir = getenv("MUNIN_SPOOLDIR")))
+		snprintf(path, sizeof(path), "%s/%s", dir, plugin);
+	else if ((dir = getenv("MUNIN_PLUGSTATE")))
+		snprintf(path, sizeof(path), "%s/%s.spool", dir, plugin);
+	else
+		return fail("neither MUNIN_SPOOLDIR nor MUNIN_PLUGSTATE set");
+	if (interval < 1)
+		interval = 1;
+
+	for (;;) {
+		long now = (long) time(NULL);
+
+		/* Reopened each time, so that the spool can be rotated */
+		if (!(spool = open_spool(path)))
+			return fail("cannot open spool file");
+		for (i = 0; i < nb; i++)
+			if (read_field(fields + i, value, sizeof(value)) == 0)
+				fprintf(spool, "%s.value %ld:%s\n",
+					fields[i].name, now, value);
+		if (fclose(spool))
+			return fail("cannot write spool file");
+		sleep(interval - now % interval);
+	}
+}
+
+int sysfs_(int argc, char **argv)
+{
+	static struct sysfs_field fields[MAX_FIELDS];
+	char value[VALUE_SIZE];
+	const char *plugin;
+	int nb, i;
+
+	plugin = basename(argv[0]);
+	if (strncmp(plugin, "sysfs_", 6) != 0
+	    && strncmp(plugin, "procfs_", 7) != 0)
+		return fail("sysfs_ invoked with invalid basename");
+
+	if ((nb = expand_fields(fields)) < 0)
+		return 1;
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "autoconf")) {
+			if (nb == 0) {
+				puts("no (no file matches)");
+				return 0;
+			}
+			return writeyes();
+		}
+		if (!strcmp(argv[1], "config")) {
+			print_config(plugin, fields, nb);
+			return 0;
+		}
+		if (!strcmp(argv[1], "acquire"))
+			return acquire(plugin, fields, nb);
+	}
+
+	for (i = 0; i < nb; i++)
+		if (read_field(fields + i, value, sizeof(value)) == 0)
+			printf("%s.value %s\n", fields[i].name, value);
+		else
+			printf("%s.value U\n", fields[i].name);
+	return 0;
+}
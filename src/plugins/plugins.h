@@ -10,20 +10,33 @@
 #define PLUGINS_H
 
 int cpu(int argc, char **argv);
+int delayacct(int argc, char **argv);
 int df(int argc, char **argv);
+int dircount_(int argc, char **argv);
 int entropy(int argc, char **argv);
 int external_(int argc, char **argv);
 int forks(int argc, char **argv);
 int fw_packets(int argc, char **argv);
+int haproxy_(int argc, char **argv);
+int http_status_(int argc, char **argv);
 int if_err_(int argc, char **argv);
 int interrupts(int argc, char **argv);
 int iostat(int argc, char **argv);
+int kvstats_(int argc, char **argv);
 int load(int argc, char **argv);
+int logtail_(int argc, char **argv);
 int memory(int argc, char **argv);
+int neigh_route(int argc, char **argv);
 int open_files(int argc, char **argv);
 int open_inodes(int argc, char **argv);
+int ping_(int argc, char **argv);
 int processes(int argc, char **argv);
+int procmem_(int argc, char **argv);
+int ps_(int argc, char **argv);
+int qdisc_(int argc, char **argv);
+int snmp__if_multi(int argc, char **argv);
 int swap(int argc, char **argv);
+int sysfs_(int argc, char **argv);
 int threads(int argc, char **argv);
 int uptime(int argc, char **argv);
 
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "procscan.h"
+#include "../probes.h"
+
+/* FNV-1a */
+static unsigned int hash_name(const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *name; name++)
+		h = (h ^ (unsigned char) *name) * 16777619u;
+	return h;
+}
+
+/* @returns the slot of name, or the empty one where it belongs */
+static unsigned int exact_slot(const struct proc_matcher *m,
+			       const char *name)
+{
+	unsigned int i = hash_name(name) & (PROC_HASH_SIZE - 1);
+
+	while (m->exact[i].name && strcmp(m->exact[i].name, name))
+		i = (i + 1) & (PROC_HASH_SIZE - 1);
+	return i;
+}
+
+int proc_matcher_add(struct proc_matcher *m, const char *pattern, int group)
+{
+	size_t prefix_len = strcspn(pattern, "*?[\\");
+	unsigned int slot;
+	int i;
+
+	if (!pattern[prefix_len]) {
+		slot = exact_slot(m, pattern);
+		if (!m->exact[slot].name) {
+			/* Keep the table at most half full */
+			if (m->nb_exact == PROC_MAX_PATTERNS)
+				return -1;
+			m->exact[slot].name = pattern;
+			m->nb_exact++;
+		}
+		m->exact[slot].groups |= UINT64_C(1) << group;
+		return 0;
+	}
+
+	for (i = 0; i < m->nb_globs; i++)
+		if (!strcmp(m->globs[i].glob, pattern)) {
+			m->globs[i].groups |= UINT64_C(1) << group;
+			return 0;
+		}
+	if (m->nb_globs == PROC_MAX_PATTERNS)
+		return -1;
+	m->globs[m->nb_globs].glob = pattern;
+	m->globs[m->nb_globs].prefix_len = prefix_len;
+	m->globs[m->nb_globs].groups = UINT64_C(1) << group;
+	m->nb_globs++;
+	return 0;
+}
+
+uint64_t proc_match(const struct proc_matcher *m, const char *name)
+{
+	uint64_t groups = 0;
+	int i;
+
+	if (m->nb_exact)
+		groups = m->exact[exact_slot(m, name)].groups;
+	for (i = 0; i < m->nb_globs; i++) {
+		if (!(m->globs[i].groups & ~groups))
+			continue;	/* nothing new to learn */
+		if (!strncmp(m->globs[i].glob, name, m->globs[i].prefix_len)
+		    && !fnmatch(m->globs[i].glob, name, 0))
+			groups |= m->globs[i].groups;
+	}
+	return groups;
+}
+
+/* Read /proc/<pid>/comm or cmdline into buf, without its trailing newline
+ * and with the NULs between arguments turned into spaces. */
+static int read_name(const char *pid, bool cmdline, char *buf, size_t size)
+{
+	char path[32];
+	ssize_t len, i;
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%s/%s", pid,
+		 cmdline ? "cmdline" : "comm");
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;	/* kernel threads have an empty cmdline */
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\0'))
+		len--;
+	for (i = 0; i < len; i++)
+		if (buf[i] == '\0')
+			buf[i] = ' ';
+	buf[len] = '\0';
+	return 0;
+}
+
+int proc_scan(const struct proc_matcher *m, proc_callback cb, void *data)
+{
+	char name[4096];
+	struct dirent *e;
+	uint64_t groups;
+	const char *s;
+	int n = 0;
+	DIR *d;
+
+	PROBE1(source__read__start, "/proc");
+	if (!(d = opendir("/proc")))
+		return -1;
+	while ((e = readdir(d))) {
+		for (s = e->d_name; *s; ++s)
+			if (!xisdigit(*s))
+				break;
+		if (*s || s == e->d_name)
+			continue;
+		++n;
+		if (read_name(e->d_name, m->cmdline, name, sizeof(name)))
+			continue;
+		if ((groups = proc_match(m, name)))
+			cb(atoi(e->d_name), groups, data);
+	}
+	closedir(d);
+	PROBE2(source__read__end, "/proc", n);
+	return n;
+}
+
+int proc_groups_env(struct proc_group *groups, struct proc_matcher *m)
+{
+	char *names, *name, *patterns, *p, *save1, *save2, env[80];
+	const char *s;
+	int nb = 0;
+
+	memset(m, 0, sizeof(*m));
+	if ((s = getenv("match")))
+		m->cmdline = !strcmp(s, "cmdline");
+	if (!(names = getenv("groups")))
+		return 0;
+
+	for (name = strtok_r(names, " \t", &save1); name;
+	     name = strtok_r(NULL, " \t", &save1)) {
+		if (nb == PROC_MAX_GROUPS) {
+			fail("too many groups");
+			return -1;
+		}
+		groups[nb].label = name;
+		snprintf(groups[nb].field, sizeof(groups[nb].field), "%s",
+			 name);
+		clean_fieldname(groups[nb].field);
+
+		snprintf(env, sizeof(env), "%s_match", name);
+		if (!(patterns = getenv(env))) {
+			if (proc_matcher_add(m, name, nb)) {
+				fail("too many patterns");
+				return -1;
+			}
+		} else {
+			for (p = strtok_r(patterns, " \t", &save2); p;
+			     p = strtok_r(NULL, " \t", &save2))
+				if (proc_matcher_add(m, p, nb)) {
+					fail("too many patterns");
+					return -1;
+				}
+		}
+		nb++;
+	}
+	return nb;
+}
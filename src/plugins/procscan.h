@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef PROCSCAN_H
+#define PROCSCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Groups are reported as a bitmask, so there are at most 64 of them. */
+#define PROC_MAX_GROUPS 64
+#define PROC_MAX_PATTERNS 256
+#define PROC_NAME_SIZE 48
+#define PROC_HASH_SIZE 512	/* power of two, twice PROC_MAX_PATTERNS */
+
+/** A named group of processes, as configured by proc_groups_env(). */
+struct proc_group {
+	char field[PROC_NAME_SIZE];
+	const char *label;
+};
+
+/** Patterns, each mapped to the groups it belongs to. Patterns without
+ * any glob character are looked up in an open addressing hash table, so
+ * that watching many exact names costs a single lookup per process. Globs
+ * are tried in turn, after comparing their literal prefix. */
+struct proc_matcher {
+	bool cmdline;		/* match the command line instead of comm */
+	int nb_exact;
+	struct {
+		const char *name;
+		uint64_t groups;
+	} exact[PROC_HASH_SIZE];
+	int nb_globs;
+	struct {
+		const char *glob;
+		size_t prefix_len;	/* characters before the first wildcard */
+		uint64_t groups;
+	} globs[PROC_MAX_PATTERNS];
+};
+
+/** Add a pattern for the given group.
+ * @returns 0 on success, -1 when there are too many patterns */
+int proc_matcher_add(struct proc_matcher *m, const char *pattern, int group);
+
+/** @returns the bitmask of the groups whose patterns match name */
+uint64_t proc_match(const struct proc_matcher *m, const char *name);
+
+/** Callback invoked for each matching process with the matched groups. */
+typedef void (*proc_callback) (int pid, uint64_t groups, void *data);
+
+/** Walk /proc once, matching every process against all the patterns at
+ * once. The command line is matched with its arguments separated by
+ * spaces. Processes vanishing meanwhile are silently skipped.
+ * @returns the number of processes seen or -1 if /proc cannot be read */
+int proc_scan(const struct proc_matcher *m, proc_callback cb, void *data);
+
+/** Configure groups and matcher from the environment:
+ *   groups            space separated group names
+ *   <group>_match     space separated patterns, the group name by default
+ *   match             "cmdline" to match the command line instead of comm
+ * The group names are passed through clean_fieldname().
+ * @returns the number of groups or -1 on error */
+int proc_groups_env(struct proc_group *groups, struct proc_matcher *m);
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "snmp.h"
+
+#define BER_SEQUENCE 0x30
+#define SNMP_VERSION_2C 1
+
+int snmp_oid_parse(const char *s, struct snmp_oid *oid)
+{
+	char *end;
+
+	oid->len = 0;
+	if (*s == '.')
+		s++;
+	while (*s) {
+		unsigned long arc = strtoul(s, &end, 10);
+
+		if (end == s || arc > UINT32_MAX || oid->len == SNMP_OID_MAX)
+			return -1;
+		oid->arcs[oid->len++] = arc;
+		if (*end == '.')
+			end++;
+		else if (*end)
+			return -1;
+		s = end;
+	}
+	return oid->len >= 2 ? 0 : -1;
+}
+
+int snmp_oid_compare(const struct snmp_oid *a, const struct snmp_oid *b)
+{
+	size_t i;
+
+	for (i = 0; i < a->len && i < b->len; i++)
+		if (a->arcs[i] != b->arcs[i])
+			return a->arcs[i] < b->arcs[i] ? -1 : 1;
+	return (a->len > b->len) - (a->len < b->len);
+}
+
+bool snmp_oid_has_prefix(const struct snmp_oid *oid,
+			 const struct snmp_oid *prefix)
+{
+	return oid->len > prefix->len
+	    && !memcmp(oid->arcs, prefix->arcs,
+		       prefix->len * sizeof(*prefix->arcs));
+}
+
+/* The encoder fills the buffer from its end, so that the length of every
+ * TLV is known when its header is written */
+struct encoder {
+	uint8_t *start, *pos;
+	bool full;
+};
+
+static void put_bytes(struct encoder *e, const void *data, size_t len)
+{
+	if (e->full || (size_t) (e->pos - e->start) < len) {
+		e->full = true;
+		return;
+	}
+	e->pos -= len;
+	memcpy(e->pos, data, len);
+}
+
+static void put_header(struct encoder *e, uint8_t type, size_t len)
+{
+	uint8_t buf[1 + 1 + sizeof(size_t)];
+	size_t n = 0;
+
+	if (len < 0x80) {
+		buf[sizeof(buf) - ++n] = len;
+	} else {
+		for (; len; len >>= 8)
+			buf[sizeof(buf) - ++n] = len & 0xff;
+		n++;
+		buf[sizeof(buf) - n] = 0x80 | (n - 1);
+	}
+	buf[sizeof(buf) - ++n] = type;
+	put_bytes(e, buf + sizeof(buf) - n, n);
+}
+
+/* Minimal big-endian two's complement, unsigned types having a leading
+ * zero byte when their top bit is set */
+static void put_integer(struct encoder *e, uint8_t type, uint64_t v)
+{
+	bool sign = type == SNMP_INTEGER;
+	uint8_t buf[9];
+	size_t n = 0;
+
+	for (;;) {
+		uint8_t low = v & 0xff;
+
+		buf[sizeof(buf) - ++n] = low;
+		v = sign ? (uint64_t) ((int64_t) v >> 8) : v >> 8;
+		if (v == 0 && !(low & 0x80))
+			break;
+		if (sign && v == UINT64_MAX && (low & 0x80))
+			break;
+		if (n == sizeof(buf))
+			break;
+	}
+	put_bytes(e, buf + sizeof(buf) - n, n);
+	put_header(e, type, n);
+}
+
+static void put_oid(struct encoder *e, const struct snmp_oid *oid)
+{
+	uint8_t *end = e->pos;
+	size_t i;
+
+	for (i = oid->len; i-- > 2;) {
+		uint32_t arc = oid->arcs[i];
+		uint8_t buf[5];
+		size_t n = 0;
+
+		/* Base 128, all bytes but the last with the top bit set */
+		do {
+			uint8_t more = n ? 0x80 : 0;
+
+			buf[sizeof(buf) - ++n] = (arc & 0x7f) | more;
+			arc >>= 7;
+		} while (arc);
+		put_bytes(e, buf + sizeof(buf) - n, n);
+	}
+	if (oid->len >= 2) {
+		uint8_t first = oid->arcs[0] * 40 + oid->arcs[1];
+
+		put_bytes(e, &first, 1);
+	}
+	put_header(e, SNMP_OBJECT_ID, end - e->pos);
+}
+
+static void put_varbind(struct encoder *e, const struct snmp_varbind *vb)
+{
+	uint8_t *end = e->pos;
+
+	switch (vb->type) {
+	case SNMP_INTEGER:
+	case SNMP_COUNTER32:
+	case SNMP_GAUGE32:
+	case SNMP_TIMETICKS:
+	case SNMP_COUNTER64:
+		put_integer(e, vb->type, vb->num);
+		break;
+	case SNMP_OCTET_STRING:
+		put_bytes(e, vb->str, vb->str_len);
+		put_header(e, vb->type, vb->str_len);
+		break;
+	default:
+		/* NULL and the exceptions have no content */
+		put_header(e, vb->type, 0);
+	}
+	put_oid(e, &vb->oid);
+	put_header(e, BER_SEQUENCE, end - e->pos);
+}
+
+ssize_t snmp_encode(uint8_t *buf, size_t size, const char *community,
+		    const struct snmp_pdu *pdu)
+{
+	struct encoder e = { buf, buf + size, false };
+	uint8_t *end = e.pos;
+	size_t i, len;
+
+	/* The varbinds, the PDU and the message all end the buffer */
+	for (i = pdu->nb_varbinds; i-- > 0;)
+		put_varbind(&e, pdu->varbinds + i);
+	put_header(&e, BER_SEQUENCE, end - e.pos);
+	put_integer(&e, SNMP_INTEGER, (uint64_t) (int64_t) pdu->error_index);
+	put_integer(&e, SNMP_INTEGER, (uint64_t) (int64_t) pdu->error_status);
+	put_integer(&e, SNMP_INTEGER, (uint64_t) (int64_t) pdu->request_id);
+	put_header(&e, pdu->type, end - e.pos);
+	put_bytes(&e, community, strlen(community));
+	put_header(&e, SNMP_OCTET_STRING, strlen(community));
+	put_integer(&e, SNMP_INTEGER, SNMP_VERSION_2C);
+	put_header(&e, BER_SEQUENCE, end - e.pos);
+	if (e.full)
+		return -1;
+
+	len = end - e.pos;
+	memmove(buf, e.pos, len);
+	return len;
+}
+
+/* The decoder walks TLVs forward, each one giving a nested decoder on its
+ * content */
+struct decoder {
+	const uint8_t *pos, *end;
+};
+
+static int get_tlv(struct decoder *d, uint8_t *type, struct decoder *content)
+{
+	size_t len = 0;
+	uint8_t n;
+
+	if (d->end - d->pos < 2)
+		return -1;
+	*type = *d->pos++;
+	n = *d->pos++;
+	if (n & 0x80) {
+		n &= 0x7f;
+		if (n == 0 || n > sizeof(uint32_t) || d->end - d->pos < n)
+			return -1;
+		while (n--)
+			len = len << 8 | *d->pos++;
+	} else {
+		len = n;
+	}
+	if ((size_t) (d->end - d->pos) < len)
+		return -1;
+	content->pos = d->pos;
+	content->end = d->pos + len;
+	d->pos += len;
+	return 0;
+}
+
+static int get_expected(struct decoder *d, uint8_t expected,
+			struct decoder *content)
+{
+	uint8_t type;
+
+	if (get_tlv(d, &type, content) < 0 || type != expected)
+		return -1;
+	return 0;
+}
+
+static uint64_t integer_value(const struct decoder *c, bool sign)
+{
+	const uint8_t *p = c->pos;
+	uint64_t v = sign && p < c->end && (*p & 0x80) ? UINT64_MAX : 0;
+
+	for (; p < c->end; p++)
+		v = v << 8 | *p;
+	return v;
+}
+
+static int get_int32(struct decoder *d, int32_t *value)
+{
+	struct decoder c;
+
+	if (get_expected(d, SNMP_INTEGER, &c) < 0 || c.end - c.pos > 4
+	    || c.end == c.pos)
+		return -1;
+	*value = (int32_t) integer_value(&c, true);
+	return 0;
+}
+
+static int get_oid(struct decoder *d, struct snmp_oid *oid)
+{
+	struct decoder c;
+	uint32_t arc = 0;
+
+	if (get_expected(d, SNMP_OBJECT_ID, &c) < 0 || c.pos == c.end)
+		return -1;
+	oid->arcs[0] = *c.pos < 80 ? *c.pos / 40 : 2;
+	oid->arcs[1] = *c.pos - oid->arcs[0] * 40;
+	oid->len = 2;
+	for (c.pos++; c.pos < c.end; c.pos++) {
+		if (arc > UINT32_MAX >> 7)
+			return -1;
+		arc = arc << 7 | (*c.pos & 0x7f);
+		if (*c.pos & 0x80)
+			continue;
+		if (oid->len == SNMP_OID_MAX)
+			return -1;
+		oid->arcs[oid->len++] = arc;
+		arc = 0;
+	}
+	return 0;
+}
+
+static int get_varbind(struct decoder *d, struct snmp_varbind *vb)
+{
+	struct decoder seq, value;
+
+	if (get_expected(d, BER_SEQUENCE, &seq) < 0
+	    || get_oid(&seq, &vb->oid) < 0
+	    || get_tlv(&seq, &vb->type, &value) < 0)
+		return -1;
+	vb->num = 0;
+	vb->str = NULL;
+	vb->str_len = 0;
+	switch (vb->type) {
+	case SNMP_INTEGER:
+	case SNMP_COUNTER32:
+	case SNMP_GAUGE32:
+	case SNMP_TIMETICKS:
+	case SNMP_COUNTER64:
+		if (value.end - value.pos > 9)
+			return -1;
+		vb->num = integer_value(&value, vb->type == SNMP_INTEGER);
+		break;
+	default:
+		vb->str = value.pos;
+		vb->str_len = value.end - value.pos;
+	}
+	return 0;
+}
+
+int snmp_decode(const uint8_t *buf, size_t len, char *community,
+		size_t community_size, struct snmp_pdu *pdu)
+{
+	struct decoder d = { buf, buf + len }, msg, c, list;
+	int32_t version;
+	size_t max = pdu->nb_varbinds, n;
+
+	if (get_expected(&d, BER_SEQUENCE, &msg) < 0
+	    || get_int32(&msg, &version) < 0
+	    || version != SNMP_VERSION_2C
+	    || get_expected(&msg, SNMP_OCTET_STRING, &c) < 0)
+		return -1;
+	n = c.end - c.pos;
+	if (n >= community_size)
+		return -1;
+	memcpy(community, c.pos, n);
+	community[n] = '\0';
+
+	if (get_tlv(&msg, &pdu->type, &c) < 0
+	    || get_int32(&c, &pdu->request_id) < 0
+	    || get_int32(&c, &pdu->error_status) < 0
+	    || get_int32(&c, &pdu->error_index) < 0
+	    || get_expected(&c, BER_SEQUENCE, &list) < 0)
+		return -1;
+	for (n = 0; n < max && list.pos < list.end; n++)
+		if (get_varbind(&list, pdu->varbinds + n) < 0)
+			return -1;
+	pdu->nb_varbinds = n;
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef SNMP_H
+#define SNMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* The BER types of SNMP values */
+#define SNMP_INTEGER		0x02
+#define SNMP_OCTET_STRING	0x04
+#define SNMP_NULL		0x05
+#define SNMP_OBJECT_ID		0x06
+#define SNMP_COUNTER32		0x41
+#define SNMP_GAUGE32		0x42
+#define SNMP_TIMETICKS		0x43
+#define SNMP_COUNTER64		0x46
+#define SNMP_NO_SUCH_OBJECT	0x80
+#define SNMP_NO_SUCH_INSTANCE	0x81
+#define SNMP_END_OF_MIB_VIEW	0x82
+
+/* The PDU types */
+#define SNMP_GET		0xa0
+#define SNMP_GETNEXT		0xa1
+#define SNMP_RESPONSE		0xa2
+#define SNMP_GETBULK		0xa5
+
+#define SNMP_OID_MAX 32
+/* Our requests and the answers of agents fit a single datagram */
+#define SNMP_MSG_MAX 65507
+
+struct snmp_oid {
+	uint32_t arcs[SNMP_OID_MAX];
+	size_t len;
+};
+
+struct snmp_varbind {
+	struct snmp_oid oid;
+	uint8_t type;
+	uint64_t num;		/* integers, counters, gauges and timeticks */
+	const uint8_t *str;	/* octet strings, pointing in the message */
+	size_t str_len;
+};
+
+/** A v2c message. For GETBULK, error_status is non-repeaters and
+ * error_index max-repetitions. */
+struct snmp_pdu {
+	uint8_t type;
+	int32_t request_id;
+	int32_t error_status;
+	int32_t error_index;
+	struct snmp_varbind *varbinds;
+	size_t nb_varbinds;
+};
+
+/** Parse a dotted OID such as "1.3.6.1.2.1.31.1.1.1.6".
+ * @returns 0 on success, -1 on error */
+int snmp_oid_parse(const char *s, struct snmp_oid *oid);
+
+/** Compare OIDs in lexicographic order, like strcmp() */
+int snmp_oid_compare(const struct snmp_oid *a, const struct snmp_oid *b);
+
+/** Tell whether oid is below prefix */
+bool snmp_oid_has_prefix(const struct snmp_oid *oid,
+			 const struct snmp_oid *prefix);
+
+/** Encode a v2c message into buf. Numbers are taken from num and octet
+ * strings from str and str_len; OID values are not supported.
+ * @returns its length, or -1 if it does not fit */
+ssize_t snmp_encode(uint8_t *buf, size_t size, const char *community,
+		    const struct snmp_pdu *pdu);
+
+/** Decode a v2c message. At most nb_varbinds varbinds are decoded into
+ * the array given in pdu, and nb_varbinds is set to their number. Octet
+ * strings point into buf. The community is copied, NUL terminated.
+ * @returns 0 on success, -1 on error */
+int snmp_decode(const uint8_t *buf, size_t len, char *community,
+		size_t community_size, struct snmp_pdu *pdu);
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sock.h"
+#include "../probes.h"
+
+long long sock_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/* Wait for events on fd until the deadline.
+ * @returns 0 when ready, -1 on timeout or error */
+static int sock_wait(int fd, short events, long long deadline)
+{
+	struct pollfd pfd;
+	long long left;
+	int ret;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	do {
+		left = deadline - sock_now_ms();
+		if (left < 0)
+			left = 0;
+		ret = poll(&pfd, 1, (int) left);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret == 0)
+		errno = ETIMEDOUT;
+	return ret > 0 ? 0 : -1;
+}
+
+static int sock_connect_addr(const struct sockaddr *sa, socklen_t len,
+			     long long deadline)
+{
+	int fd, err;
+	socklen_t errlen = sizeof(err);
+
+	fd = socket(sa->sa_family,
+		    SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, sa, len) == 0)
+		return fd;
+	if (errno != EINPROGRESS && errno != EAGAIN)
+		goto error;
+	if (deadline < 0)
+		return fd;	/* sock_connect_start() */
+	if (sock_wait(fd, POLLOUT, deadline) < 0)
+		goto error;
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0)
+		goto error;
+	if (err != 0) {
+		errno = err;
+		goto error;
+	}
+	return fd;
+
+      error:
+	close(fd);
+	return -1;
+}
+
+int sock_connect(const char *address, const char *default_port,
+		 long long deadline)
+{
+	char host[256];
+	const char *port, *end;
+	struct addrinfo hints, *res, *ai;
+	int fd = -1;
+
+	if (!strncmp(address, "unix:", 5))
+		address += 5;
+	if (address[0] == '/') {
+		struct sockaddr_un sa_un;
+
+		memset(&sa_un, 0, sizeof(sa_un));
+		sa_un.sun_family = AF_UNIX;
+		if (strlen(address) >= sizeof(sa_un.sun_path)) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		strcpy(sa_un.sun_path, address);
+		return sock_connect_addr((struct sockaddr *) &sa_un,
+					 sizeof(sa_un), deadline);
+	}
+
+	/* [v6addr]:port, host:port or host */
+	if (address[0] == '[' && (end = strchr(address, ']'))) {
+		address++;
+		port = end[1] == ':' ? end + 2 : default_port;
+	} else if ((end = strrchr(address, ':'))) {
+		port = end + 1;
+	} else {
+		end = address + strlen(address);
+		port = default_port;
+	}
+	if ((size_t) (end - address) >= sizeof(host)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	memcpy(host, address, end - address);
+	host[end - address] = '\0';
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0) {
+		errno = EHOSTUNREACH;
+		return -1;
+	}
+	for (ai = res; ai && fd < 0; ai = ai->ai_next)
+		fd = sock_connect_addr(ai->ai_addr, ai->ai_addrlen,
+				       deadline);
+	freeaddrinfo(res);
+	return fd;
+}
+
+int sock_connect_start(const char *address, const char *default_port)
+{
+	return sock_connect(address, default_port, -1);
+}
+
+int sock_connected(int fd)
+{
+	int err;
+	socklen_t errlen = sizeof(err);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0)
+		return -1;
+	if (err != 0) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+int sock_send(int fd, const void *buf, size_t len, long long deadline)
+{
+	const char *p = buf;
+
+	while (len > 0) {
+		ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return -1;
+			if (sock_wait(fd, POLLOUT, deadline) < 0)
+				return -1;
+			continue;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+ssize_t sock_recv(int fd, void *buf, size_t size, long long deadline)
+{
+	for (;;) {
+		ssize_t n = recv(fd, buf, size, 0);
+		if (n >= 0)
+			return n;
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return -1;
+		if (sock_wait(fd, POLLIN, deadline) < 0)
+			return -1;
+	}
+}
+
+ssize_t sock_transact(int fd, const char *req, size_t req_len, char *buf,
+		      size_t size, long long deadline,
+		      sock_complete is_complete, void *data)
+{
+	ssize_t len = 0;
+
+	PROBE1(source__read__start, "socket");
+	if (sock_send(fd, req, req_len, deadline) < 0)
+		len = -1;
+
+	while (len >= 0 && (size_t) len + 1 < size) {
+		ssize_t n = sock_recv(fd, buf + len, size - 1 - len,
+				      deadline);
+		if (n <= 0) {
+			if (n < 0)
+				len = -1;
+			break;
+		}
+		len += n;
+		buf[len] = '\0';
+		if (is_complete && is_complete(buf, len, data))
+			break;
+	}
+	PROBE2(source__read__end, "socket", len);
+	if (len < 0)
+		return -1;
+	buf[len] = '\0';
+	return len;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef SOCK_H
+#define SOCK_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/** Milliseconds on a monotonic clock, used to compute deadlines. */
+long long sock_now_ms(void);
+
+/** Connect to "/path/to/socket", "unix:/path/to/socket", "host:port" or
+ * "[v6addr]:port". default_port is used for "host" alone. The returned
+ * socket is non-blocking.
+ * @returns the socket or -1 on error or timeout */
+int sock_connect(const char *address, const char *default_port,
+		 long long deadline);
+
+/** Start connecting like sock_connect(), without waiting: the connection
+ * may still be in progress. Once the socket is writable, sock_connected()
+ * tells whether it succeeded. Only the first address that does not fail
+ * at once is tried.
+ * @returns the socket or -1 on error */
+int sock_connect_start(const char *address, const char *default_port);
+
+/** @returns 0 if the connection started on fd is established, -1 with
+ * errno set if it failed */
+int sock_connected(int fd);
+
+/** Write the whole buffer before the deadline.
+ * @returns 0 on success, -1 on error or timeout */
+int sock_send(int fd, const void *buf, size_t len, long long deadline);
+
+/** Read what is available, waiting until the deadline if nothing is.
+ * @returns the number of bytes read, 0 on EOF, -1 on error or timeout */
+ssize_t sock_recv(int fd, void *buf, size_t size, long long deadline);
+
+/** Tells sock_transact() whether the response in buf is complete. */
+typedef bool (*sock_complete) (const char *buf, size_t len, void *data);
+
+/** Send a request and read the response into buf until the peer closes
+ * the connection, is_complete returns true or buf is full. buf is always
+ * NUL terminated, so at most size - 1 bytes are read.
+ * @returns the length of the response or -1 on error or timeout */
+ssize_t sock_transact(int fd, const char *req, size_t req_len, char *buf,
+		      size_t size, long long deadline,
+		      sock_complete is_complete, void *data);
+
+#endif
@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#define DEFAULT_PORT "4949"
+#define MAX_EVENTS 256
+#define READ_CHUNK 4096
+/* A reply line longer than that is not from a munin node */
+#define READ_MAX (1024 * 1024)
+
+/* A session walks these states in order */
+enum state {
+	CONNECTING,
+	GREETING,
+	CAPS,
+	LIST,
+	REPLIES,
+	QUITTING,
+};
+
+struct session {
+	struct session *prev, *next;	/* running sessions, by deadline */
+	const char *host;
+	int fd;
+	enum state state;
+	uint32_t events;		/* registered with epoll */
+	long start, deadline;		/* ms */
+	bool pipelining;
+	char *rbuf, *wbuf;
+	size_t rlen, rsize, woff, wlen, wsize;
+	char *list;			/* owns plugins, unless NULL */
+	char **plugins;
+	size_t nb_plugins;
+	size_t sent, replied;		/* commands */
+	char graph[256];		/* current multigraph, if any */
+	char error[128];
+};
+
+static const char *cmds[2] = { "fetch", NULL };
+static size_t nb_cmds = 1;
+static char **fixed_plugins;
+static size_t nb_fixed_plugins;
+static const char *port = DEFAULT_PORT;
+static long timeout_ms = 10000;
+static bool json, quiet, verbose;
+
+static int epfd;
+static struct session *head, *tail;
+static size_t nb_running;
+static unsigned long nb_ok, nb_failed;
+
+static long now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++) {
+		unsigned char c = *s;
+
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+/* Print a record, as a TSV or a JSON line */
+static void emit(const struct session *s, const char *graph,
+		 const char *kind, const char *key, const char *value)
+{
+	if (!json) {
+		printf("%s\t%s\t%s\t%s\t%s\n", s->host, graph ? graph : "-",
+		       kind, key, value);
+		return;
+	}
+	fputs("{\"host\":", stdout);
+	json_string(s->host);
+	if (graph) {
+		fputs(",\"graph\":", stdout);
+		json_string(graph);
+	}
+	fputs(",\"kind\":", stdout);
+	json_string(kind);
+	fputs(",\"key\":", stdout);
+	json_string(key);
+	fputs(",\"value\":", stdout);
+	json_string(value);
+	fputs("}\n", stdout);
+}
+
+static int fail(struct session *s, const char *error)
+{
+	snprintf(s->error, sizeof(s->error), "%s", error);
+	return -1;
+}
+
+/* Report the session and forget it */
+static void finish(struct session *s, const char *error)
+{
+	if (error) {
+		nb_failed++;
+		emit(s, NULL, "status", "error", error);
+	} else {
+		char elapsed[32];
+
+		nb_ok++;
+		snprintf(elapsed, sizeof(elapsed), "%ld", now_ms() - s->start);
+		emit(s, NULL, "status", "ok", elapsed);
+	}
+
+	if (s->prev)
+		s->prev->next = s->next;
+	else
+		head = s->next;
+	if (s->next)
+		s->next->prev = s->prev;
+	else
+		tail = s->prev;
+	nb_running--;
+
+	if (s->fd >= 0)
+		close(s->fd);
+	if (s->list) {
+		free(s->list);
+		free(s->plugins);
+	}
+	free(s->rbuf);
+	free(s->wbuf);
+	free(s);
+}
+
+static int watch(struct session *s, uint32_t events)
+{
+	struct epoll_event ev;
+
+	if (events == s->events)
+		return 0;
+	ev.events = events;
+	ev.data.ptr = s;
+	if (epoll_ctl(epfd, s->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+		      s->fd, &ev) < 0)
+		return -1;
+	s->events = events;
+	return 0;
+}
+
+/* Append "cmd arg\n" to the output buffer */
+static int queue(struct session *s, const char *cmd, const char *arg)
+{
+	size_t cmd_len = strlen(cmd), arg_len = arg ? strlen(arg) : 0;
+	size_t len = cmd_len + (arg ? arg_len + 1 : 0) + 1;
+
+	if (s->woff == s->wlen)
+		s->woff = s->wlen = 0;
+	if (s->wlen + len > s->wsize) {
+		size_t size = s->wsize ? s->wsize : 256;
+		char *buf;
+
+		while (size < s->wlen + len)
+			size *= 2;
+		if (!(buf = realloc(s->wbuf, size)))
+			return fail(s, "out of memory");
+		s->wbuf = buf;
+		s->wsize = size;
+	}
+	memcpy(s->wbuf + s->wlen, cmd, cmd_len);
+	s->wlen += cmd_len;
+	if (arg) {
+		s->wbuf[s->wlen++] = ' ';
+		memcpy(s->wbuf + s->wlen, arg, arg_len);
+		s->wlen += arg_len;
+	}
+	s->wbuf[s->wlen++] = '\n';
+	return 0;
+}
+
+/* Send what the node can take, and wait for the rest */
+static int flush(struct session *s)
+{
+	while (s->woff < s->wlen) {
+		ssize_t n = send(s->fd, s->wbuf + s->woff, s->wlen - s->woff,
+				 MSG_NOSIGNAL);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n < 0)
+			return fail(s, strerror(errno));
+		s->woff += n;
+	}
+	if (watch(s, EPOLLIN | (s->woff < s->wlen ? EPOLLOUT : 0)) < 0)
+		return fail(s, strerror(errno));
+	return 0;
+}
+
+static size_t nb_commands(const struct session *s)
+{
+	return s->nb_plugins * nb_cmds;
+}
+
+/* All the commands at once when pipelining, else the next one */
+static int queue_commands(struct session *s)
+{
+	size_t n = s->pipelining ? nb_commands(s) : s->replied + 1;
+
+	for (; s->sent < n; s->sent++)
+		if (queue(s, cmds[s->sent % nb_cmds],
+			  s->plugins[s->sent / nb_cmds]) < 0)
+			return -1;
+	return 0;
+}
+
+static int start_replies(struct session *s)
+{
+	if (nb_commands(s) == 0) {
+		s->state = QUITTING;
+		return queue(s, "quit", NULL);
+	}
+	s->state = REPLIES;
+	return queue_commands(s);
+}
+
+/* Split the space separated plugins of a list reply */
+static int parse_list(struct session *s, const char *line)
+{
+	size_t size = 16;
+	char *name;
+
+	if (!(s->list = strdup(line))
+	    || !(s->plugins = malloc(size * sizeof(*s->plugins))))
+		return fail(s, "out of memory");
+	for (name = strtok(s->list, " "); name; name = strtok(NULL, " ")) {
+		if (s->nb_plugins == size) {
+			char **plugins;
+
+			size *= 2;
+			plugins = realloc(s->plugins,
+					  size * sizeof(*s->plugins));
+			if (!plugins)
+				return fail(s, "out of memory");
+			s->plugins = plugins;
+		}
+		s->plugins[s->nb_plugins++] = name;
+	}
+	return 0;
+}
+
+static int handle_reply(struct session *s, char *line)
+{
+	const char *plugin = s->plugins[s->replied / nb_cmds];
+	const char *cmd = cmds[s->replied % nb_cmds];
+	char *key = line, *value;
+	size_t len;
+
+	if (!strcmp(line, ".")) {
+		s->graph[0] = '\0';
+		if (++s->replied < nb_commands(s))
+			return queue_commands(s);
+		s->state = QUITTING;
+		return queue(s, "quit", NULL);
+	}
+	if (line[0] == '#' || line[0] == '\0')
+		return 0;
+	if (!strncmp(line, "multigraph ", 11)) {
+		snprintf(s->graph, sizeof(s->graph), "%s", line + 11);
+		return 0;
+	}
+	if (quiet)
+		return 0;
+
+	if ((value = strchr(line, ' ')))
+		*value++ = '\0';
+	else
+		value = "";
+	len = strlen(key);
+	if (!strcmp(cmd, "fetch") && len > 6
+	    && !strcmp(key + len - 6, ".value"))
+		key[len - 6] = '\0';
+	if (!json)
+		for (line = value; (line = strchr(line, '\t'));)
+			*line = ' ';
+	emit(s, *s->graph ? s->graph : plugin, cmd, key, value);
+	return 0;
+}
+
+static int handle_line(struct session *s, char *line)
+{
+	char *cap;
+
+	switch (s->state) {
+	case GREETING:
+		if (strncmp(line, "# munin node at ", 16))
+			return fail(s, "not a munin node");
+		s->state = CAPS;
+		return queue(s, "cap", "multigraph pipelining");
+	case CAPS:
+		/* Older nodes answer with an unknown command comment */
+		if (!strncmp(line, "cap ", 4))
+			for (cap = strtok(line + 4, " "); cap;
+			     cap = strtok(NULL, " "))
+				if (!strcmp(cap, "pipelining"))
+					s->pipelining = true;
+		if (fixed_plugins) {
+			s->plugins = fixed_plugins;
+			s->nb_plugins = nb_fixed_plugins;
+			return start_replies(s);
+		}
+		s->state = LIST;
+		return queue(s, "list", NULL);
+	case LIST:
+		if (parse_list(s, line) < 0)
+			return -1;
+		return start_replies(s);
+	case REPLIES:
+		return handle_reply(s, line);
+	default:
+		return 0;
+	}
+}
+
+/* Read and handle the complete lines.
+ * @returns 0 when more is expected, 1 at the end, -1 on error */
+static int receive(struct session *s)
+{
+	for (;;) {
+		char *line, *nl, *end;
+		ssize_t n;
+
+		if (s->rsize - s->rlen < READ_CHUNK) {
+			size_t size = s->rsize ? s->rsize * 2 : READ_CHUNK * 2;
+			char *buf;
+
+			if (size > READ_MAX)
+				return fail(s, "line too long");
+			if (!(buf = realloc(s->rbuf, size)))
+				return fail(s, "out of memory");
+			s->rbuf = buf;
+			s->rsize = size;
+		}
+		n = recv(s->fd, s->rbuf + s->rlen, s->rsize - s->rlen, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		if (n < 0)
+			return fail(s, strerror(errno));
+		if (n == 0)
+			return s->state == QUITTING ? 1
+			    : fail(s, "connection closed");
+
+		s->rlen += n;
+		end = s->rbuf + s->rlen;
+		for (line = s->rbuf; (nl = memchr(line, '\n', end - line));
+		     line = nl + 1) {
+			*nl = '\0';
+			if (nl > line && nl[-1] == '\r')
+				nl[-1] = '\0';
+			if (handle_line(s, line) < 0)
+				return -1;
+		}
+		s->rlen = end - line;
+		memmove(s->rbuf, line, s->rlen);
+	}
+}
+
+static void handle_event(struct session *s, uint32_t events)
+{
+	int ret = 0;
+
+	if (s->state == CONNECTING) {
+		socklen_t len = sizeof(ret);
+
+		if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &ret, &len) < 0)
+			ret = errno;
+		if (ret) {
+			finish(s, strerror(ret));
+			return;
+		}
+		s->state = GREETING;
+	} else if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		ret = receive(s);
+	}
+	if (ret == 0)
+		ret = flush(s);
+
+	if (ret < 0)
+		finish(s, s->error);
+	else if (ret > 0 || (s->state == QUITTING && s->woff == s->wlen))
+		finish(s, NULL);
+}
+
+/* Split "host", "host:port", "[address]:port" or an IPv6 address */
+static int split_host(const char *host, char *name, size_t size,
+		      const char **service)
+{
+	const char *colon = strchr(host, ':');
+	size_t len = strlen(host);
+
+	if (host[0] == '[') {
+		const char *end = strchr(host, ']');
+
+		if (!end || (end[1] && end[1] != ':'))
+			return -1;
+		if (end[1] == ':')
+			*service = end + 2;
+		host++;
+		len = end - host;
+	} else if (colon && colon == strrchr(host, ':')) {
+		*service = colon + 1;
+		len = colon - host;
+	}
+	if (len == 0 || len >= size)
+		return -1;
+	memcpy(name, host, len);
+	name[len] = '\0';
+	return 0;
+}
+
+/* Start a session, connecting in the background */
+static void start(const char *host)
+{
+	struct addrinfo hints, *ai;
+	char name[NI_MAXHOST];
+	const char *service = port;
+	struct session *s;
+	int err;
+
+	if (!(s = calloc(1, sizeof(*s)))) {
+		nb_failed++;
+		fprintf(stderr, "munin-poll-c: out of memory\n");
+		return;
+	}
+	s->host = host;
+	s->fd = -1;
+	s->start = now_ms();
+	s->deadline = s->start + timeout_ms;
+	/* All sessions have the same timeout: the list stays sorted */
+	s->prev = tail;
+	if (tail)
+		tail->next = s;
+	else
+		head = s;
+	tail = s;
+	nb_running++;
+
+	if (split_host(host, name, sizeof(name), &service) < 0) {
+		finish(s, "invalid address");
+		return;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if ((err = getaddrinfo(name, service, &hints, &ai))) {
+		finish(s, gai_strerror(err));
+		return;
+	}
+	s->fd = socket(ai->ai_family,
+		       ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		       ai->ai_protocol);
+	if (s->fd < 0
+	    || (connect(s->fd, ai->ai_addr, ai->ai_addrlen) < 0
+		&& errno != EINPROGRESS)
+	    || watch(s, EPOLLOUT) < 0) {
+		freeaddrinfo(ai);
+		finish(s, strerror(errno));
+		return;
+	}
+	freeaddrinfo(ai);
+}
+
+/* Split a comma separated list of plugins given with -l */
+static int parse_fixed_plugins(char *arg)
+{
+	char *name;
+
+	for (name = strtok(arg, ","); name; name = strtok(NULL, ",")) {
+		char **plugins = realloc(fixed_plugins,
+					 (nb_fixed_plugins + 1) *
+					 sizeof(*fixed_plugins));
+
+		if (!plugins)
+			return -1;
+		fixed_plugins = plugins;
+		fixed_plugins[nb_fixed_plugins++] = name;
+	}
+	return 0;
+}
+
+/* Read the hosts from stdin, one per line */
+static char **read_hosts(size_t *nb_hosts)
+{
+	char **hosts = NULL, *line = NULL;
+	size_t size = 0;
+
+	*nb_hosts = 0;
+	while (getline(&line, &size, stdin) != -1) {
+		char *host = line + strspn(line, " \t"), **more;
+
+		host[strcspn(host, " \t\r\n")] = '\0';
+		if (*host == '\0' || *host == '#')
+			continue;
+		more = realloc(hosts, (*nb_hosts + 1) * sizeof(*hosts));
+		if (!more || !(host = strdup(host)))
+			return NULL;
+		hosts = more;
+		hosts[(*nb_hosts)++] = host;
+	}
+	free(line);
+	return hosts;
+}
+
+/* Thousands of sessions need as many file descriptors */
+static void raise_nofile(rlim_t need)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur >= need)
+		return;
+	rl.rlim_cur = need < rl.rlim_max ? need : rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-jqv] [-c sessions] [-t seconds] "
+		"[-p port] [-m fetch|config|both]\n"
+		"\t[-l plugin,...] [-n rounds] [host[:port]...]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	struct epoll_event events[MAX_EVENTS];
+	char **hosts;
+	size_t nb_hosts, concurrency = 512, rounds = 1, next = 0;
+	long begin;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:jl:m:n:p:qt:v")) != -1) {
+		switch (opt) {
+		case 'c':
+			concurrency = strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			json = true;
+			break;
+		case 'l':
+			if (parse_fixed_plugins(optarg) < 0) {
+				fprintf(stderr, "%s: out of memory\n", argv[0]);
+				return 1;
+			}
+			break;
+		case 'm':
+			if (!strcmp(optarg, "fetch")) {
+				cmds[0] = "fetch";
+				nb_cmds = 1;
+			} else if (!strcmp(optarg, "config")) {
+				cmds[0] = "config";
+				nb_cmds = 1;
+			} else if (!strcmp(optarg, "both")) {
+				cmds[0] = "config";
+				cmds[1] = "fetch";
+				nb_cmds = 2;
+			} else {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'n':
+			rounds = strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		case 't':
+			timeout_ms = (long) (strtod(optarg, NULL) * 1000);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (concurrency == 0 || rounds == 0 || timeout_ms <= 0) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	if (optind < argc) {
+		hosts = argv + optind;
+		nb_hosts = argc - optind;
+	} else if (!(hosts = read_hosts(&nb_hosts))) {
+		if (ferror(stdin) || errno == ENOMEM) {
+			fprintf(stderr, "%s: cannot read the hosts\n", argv[0]);
+			return 1;
+		}
+		return 0;
+	}
+
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		perror("epoll_create1");
+		return 1;
+	}
+	raise_nofile(concurrency + 16);
+
+	begin = now_ms();
+	while (next < nb_hosts * rounds || nb_running) {
+		long wait, now;
+		int n, i;
+
+		while (nb_running < concurrency && next < nb_hosts * rounds)
+			start(hosts[next++ % nb_hosts]);
+		if (!head)
+			continue;
+
+		wait = head->deadline - now_ms();
+		n = epoll_wait(epfd, events, MAX_EVENTS, wait > 0 ? wait : 0);
+		if (n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			return 1;
+		}
+		/* Only a session's own event may finish it: the others of
+		 * the batch stay valid */
+		for (i = 0; i < n; i++)
+			handle_event(events[i].data.ptr, events[i].events);
+
+		now = now_ms();
+		while (head && head->deadline <= now)
+			finish(head, "timeout");
+	}
+	fflush(stdout);
+
+	if (verbose)
+		fprintf(stderr, "%lu sessions, %lu ok, %lu failed in %ld ms\n",
+			nb_ok + nb_failed, nb_ok, nb_failed, now_ms() - begin);
+	return nb_failed ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 The munin-c contributors - All rights reserved.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2 or v.3.
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+/* USDT probes of the "munin" provider, for bpftrace and perf, e.g.
+ *   bpftrace -e 'usdt:/usr/sbin/munin-node-c:munin:plugin__reap { ... }'
+ * With --with-usdt a probe is a nop instruction and an ELF note, without
+ * it nothing at all; the arguments are never evaluated. */
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+/* sdt.h casts each argument to its own type to tell its signedness, which
+ * C does not allow for arrays: string literals and buffers decay first */
+#define PROBE_ARG(x) ((x) + 0)
+#define PROBE(name) DTRACE_PROBE(munin, name)
+#define PROBE1(name, a) DTRACE_PROBE1(munin, name, PROBE_ARG(a))
+#define PROBE2(name, a, b) \
+	DTRACE_PROBE2(munin, name, PROBE_ARG(a), PROBE_ARG(b))
+#define PROBE3(name, a, b, c) \
+	DTRACE_PROBE3(munin, name, PROBE_ARG(a), PROBE_ARG(b), PROBE_ARG(c))
+#else
+#define PROBE(name) ((void) 0)
+#define PROBE1(name, a) ((void) sizeof(a))
+#define PROBE2(name, a, b) ((void) sizeof(a), (void) sizeof(b))
+#define PROBE3(name, a, b, c) \
+	((void) sizeof(a), (void) sizeof(b), (void) sizeof(c))
+#endif
+
+#endif
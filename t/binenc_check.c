@@ -0,0 +1,51 @@
+/* Encode and decode fetch outputs with the binary encoding of the node.
+ *
+ * usage: binenc_check encode|decode
+ *
+ * encode reads fetch outputs, each ended by a "." line, and writes their
+ * frames within a single session. decode reads frames and writes the
+ * values of each 'V' frame followed by a "." line, so that decoding what
+ * was encoded gives the input back. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/node/binenc.h"
+
+int main(int argc, char *argv[])
+{
+	static char output[65536];
+	struct binenc dictionary;
+	char line[4096];
+	size_t used = 0;
+	int type;
+
+	memset(&dictionary, 0, sizeof(dictionary));
+	if (argc == 2 && !strcmp(argv[1], "decode")) {
+		while ((type = binenc_decode(&dictionary, stdin, stdout)) > 0)
+			if (type == BINENC_VALUES)
+				printf(".\n");
+		binenc_free(&dictionary);
+		return type < 0;
+	}
+	if (argc != 2 || strcmp(argv[1], "encode")) {
+		fprintf(stderr, "usage: %s encode|decode\n", argv[0]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), stdin)) {
+		size_t len = strlen(line);
+
+		if (strcmp(line, ".\n")) {
+			if (used + len >= sizeof(output))
+				return 1;
+			memcpy(output + used, line, len + 1);
+			used += len;
+			continue;
+		}
+		if (binenc_fetch(&dictionary, output, stdout) < 0)
+			return 1;
+		output[used = 0] = '\0';
+	}
+	binenc_free(&dictionary);
+	return 0;
+}
@@ -0,0 +1,23 @@
+/* Give field names to identifiers as a plugin would, for testing fieldid.
+ *
+ * usage: fieldid_check plugin key...
+ *
+ * The names given before by plugin are loaded from $MUNIN_PLUGSTATE, a
+ * "key name" line is written for each key, and the names are saved. */
+#include <stdio.h>
+#include "../src/plugins/fieldid.h"
+
+int main(int argc, char *argv[])
+{
+	static struct field_ids ids;
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s plugin key...\n", argv[0]);
+		return 1;
+	}
+	field_ids_load(&ids, argv[1]);
+	for (i = 2; i < argc; i++)
+		printf("%s %s\n", argv[i], field_id(&ids, argv[i]));
+	return field_ids_save(&ids, argv[1]) < 0;
+}
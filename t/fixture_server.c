@@ -0,0 +1,67 @@
+/* Serve a canned response on a unix socket, for testing network plugins.
+ *
+ * usage: fixture_server <socket path> <response file> [connections [delay]]
+ *
+ * For each connection the request is read (a single read is enough for the
+ * small requests of the plugins), then the response file is sent verbatim
+ * and the connection is closed. Exits after the given number of
+ * connections, 1 by default. The response may be delayed by some seconds,
+ * to play a stalled server. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_un addr;
+	char buf[4096];
+	int fd, conn, nb, delay;
+	size_t len;
+	FILE *f;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s socket response "
+			"[connections [delay]]\n", argv[0]);
+		return 1;
+	}
+	nb = argc > 3 ? atoi(argv[3]) : 1;
+	delay = argc > 4 ? atoi(argv[4]) : 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+	unlink(argv[1]);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+	    || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+	    || listen(fd, 5) < 0) {
+		perror("cannot listen");
+		return 1;
+	}
+
+	while (nb-- > 0) {
+		if ((conn = accept(fd, NULL, NULL)) < 0) {
+			perror("accept");
+			return 1;
+		}
+		if (read(conn, buf, sizeof(buf)) < 0)
+			perror("read");
+		sleep(delay);
+		if (!(f = fopen(argv[2], "r"))) {
+			perror("cannot open response");
+			return 1;
+		}
+		while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+			if (write(conn, buf, len) < 0)
+				break;
+		fclose(f);
+		close(conn);
+	}
+
+	close(fd);
+	unlink(argv[1]);
+	return 0;
+}
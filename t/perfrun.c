@@ -0,0 +1,169 @@
+/* Measure the cost of running a command, for the performance budgets.
+ *
+ * usage: perfrun [-n runs] [-i input] command [args...]
+ *
+ * Prints "latency_us rss_kb syscalls opens": the median time from fork to
+ * exit over the given runs (5 by default), the largest peak RSS reported
+ * by wait4, and the system calls and the files opened in a single run
+ * traced with ptrace. Each run reads the input file, /dev/null by default,
+ * and its output is discarded. A run that does not exit 0 is a failure:
+ * its measures would not be those of the work budgeted. */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_RUNS 101
+
+static const char *input = "/dev/null";
+
+static pid_t spawn(char **argv, int traced)
+{
+	pid_t pid = fork();
+	int fd;
+
+	if (pid != 0)
+		return pid;
+	if ((fd = open(input, O_RDONLY)) < 0
+	    || dup2(fd, STDIN_FILENO) < 0)
+		_exit(126);
+	close(fd);
+	if ((fd = open("/dev/null", O_WRONLY)) < 0
+	    || dup2(fd, STDOUT_FILENO) < 0)
+		_exit(126);
+	close(fd);
+	if (traced && ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
+		_exit(126);
+	execv(argv[0], argv);
+	_exit(127);
+}
+
+static int compare_long(const void *a, const void *b)
+{
+	long x = *(const long *) a, y = *(const long *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Whether a run exited 0, telling which command failed otherwise */
+static int succeeded(char **argv, int status)
+{
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 1;
+	if (WIFEXITED(status))
+		fprintf(stderr, "perfrun: %s exited with status %d\n",
+			argv[0], WEXITSTATUS(status));
+	else
+		fprintf(stderr, "perfrun: %s killed by signal %d\n",
+			argv[0], WTERMSIG(status));
+	return 0;
+}
+
+/* Run the command under ptrace, counting its system calls.
+ * @returns its wait status, -1 if it could not be traced */
+static int trace(char **argv, long *syscalls, long *opens)
+{
+	struct __ptrace_syscall_info info;
+	int status, sig = 0;
+	pid_t pid;
+
+	*syscalls = *opens = 0;
+	if ((pid = spawn(argv, 1)) < 0)
+		return -1;
+	/* Stopped at exec */
+	if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+		return -1;
+	ptrace(PTRACE_SETOPTIONS, pid, NULL,
+	       PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+	for (;;) {
+		if (ptrace(PTRACE_SYSCALL, pid, NULL, sig) < 0)
+			return -1;
+		if (waitpid(pid, &status, 0) < 0)
+			return -1;
+		if (WIFEXITED(status) || WIFSIGNALED(status))
+			return status;
+		sig = WSTOPSIG(status);
+		if (sig != (SIGTRAP | 0x80))
+			continue;	/* a signal, delivered */
+		sig = 0;
+		if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, sizeof(info),
+			   &info) < 0
+		    || info.op != PTRACE_SYSCALL_INFO_ENTRY)
+			continue;
+		(*syscalls)++;
+		if (info.entry.nr == SYS_openat
+#ifdef SYS_open
+		    || info.entry.nr == SYS_open
+#endif
+#ifdef SYS_openat2
+		    || info.entry.nr == SYS_openat2
+#endif
+		    )
+			(*opens)++;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	long latencies[MAX_RUNS], rss = 0, syscalls, opens;
+	int opt, runs = 5, i, status;
+
+	while ((opt = getopt(argc, argv, "+n:i:")) != -1)
+		switch (opt) {
+		case 'n':
+			runs = atoi(optarg);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		default:
+			return 2;
+		}
+	if (optind == argc || runs < 1 || runs > MAX_RUNS) {
+		fprintf(stderr, "usage: %s [-n runs] [-i input] command...\n",
+			argv[0]);
+		return 2;
+	}
+
+	for (i = 0; i < runs; i++) {
+		struct timespec start, end;
+		struct rusage ru;
+		pid_t pid;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if ((pid = spawn(argv + optind, 0)) < 0
+		    || wait4(pid, &status, 0, &ru) < 0) {
+			perror("perfrun");
+			return 1;
+		}
+		if (!succeeded(argv + optind, status))
+			return 1;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		latencies[i] = (end.tv_sec - start.tv_sec) * 1000000
+		    + (end.tv_nsec - start.tv_nsec) / 1000;
+		if (ru.ru_maxrss > rss)
+			rss = ru.ru_maxrss;
+	}
+	qsort(latencies, runs, sizeof(latencies[0]), compare_long);
+
+	if ((status = trace(argv + optind, &syscalls, &opens)) < 0) {
+		fprintf(stderr, "perfrun: cannot trace: %s\n",
+			strerror(errno));
+		return 1;
+	}
+	if (!succeeded(argv + optind, status))
+		return 1;
+	printf("%ld %ld %ld %ld\n", latencies[runs / 2], rss, syscalls,
+	       opens);
+	return 0;
+}
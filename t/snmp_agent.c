@@ -0,0 +1,214 @@
+/* A minimal SNMP v2c agent serving a walk file, for testing snmp plugins.
+ *
+ * usage: snmp_agent [-c community] [-d drops] port_file walk_file
+ *
+ * The agent listens on a free UDP port of 127.0.0.1, written to port_file
+ * once it is ready. The walk file has an "oid type value" line per object,
+ * the type being s (octet string), i (integer), c (counter32), g (gauge32)
+ * or C (counter64). GET, GETNEXT and GETBULK are answered, requests with
+ * another community are ignored and so are the first drops requests, to
+ * exercise retries. Exits after 30 seconds without requests. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "../src/plugins/snmp.h"
+
+#define OBJECTS_MAX 4096
+#define VARBINDS_MAX 128
+
+struct object {
+	struct snmp_varbind vb;
+	char str[128];
+};
+
+static struct object objects[OBJECTS_MAX];
+static size_t nb_objects;
+
+static int compare_objects(const void *a, const void *b)
+{
+	return snmp_oid_compare(&((const struct object *) a)->vb.oid,
+				&((const struct object *) b)->vb.oid);
+}
+
+static int load(const char *path)
+{
+	char line[256], oid[128], type[4], value[128];
+	FILE *f = fopen(path, "r");
+	size_t i;
+
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f) && nb_objects < OBJECTS_MAX) {
+		struct object *o = objects + nb_objects;
+
+		if (sscanf(line, "%127s %3s %127[^\n]", oid, type, value) != 3
+		    || snmp_oid_parse(oid, &o->vb.oid) < 0)
+			continue;
+		switch (type[0]) {
+		case 's':
+			strcpy(o->str, value);
+			o->vb.type = SNMP_OCTET_STRING;
+			o->vb.str_len = strlen(value);
+			break;
+		case 'i':
+			o->vb.type = SNMP_INTEGER;
+			break;
+		case 'c':
+			o->vb.type = SNMP_COUNTER32;
+			break;
+		case 'g':
+			o->vb.type = SNMP_GAUGE32;
+			break;
+		case 'C':
+			o->vb.type = SNMP_COUNTER64;
+			break;
+		default:
+			continue;
+		}
+		o->vb.num = strtoull(value, NULL, 10);
+		nb_objects++;
+	}
+	fclose(f);
+	qsort(objects, nb_objects, sizeof(*objects), compare_objects);
+	for (i = 0; i < nb_objects; i++)
+		objects[i].vb.str = (const uint8_t *) objects[i].str;
+	return 0;
+}
+
+/* The object at oid, or the one after it */
+static void lookup(const struct snmp_oid *oid, bool next,
+		   struct snmp_varbind *vb)
+{
+	size_t i;
+
+	for (i = 0; i < nb_objects; i++) {
+		int cmp = snmp_oid_compare(&objects[i].vb.oid, oid);
+
+		if (next ? cmp > 0 : cmp == 0) {
+			*vb = objects[i].vb;
+			return;
+		}
+	}
+	memset(vb, 0, sizeof(*vb));
+	vb->oid = *oid;
+	vb->type = next ? SNMP_END_OF_MIB_VIEW : SNMP_NO_SUCH_OBJECT;
+}
+
+static void answer(struct snmp_pdu *req, struct snmp_pdu *resp)
+{
+	static struct snmp_varbind out[VARBINDS_MAX];
+	size_t i, r, n = 0, non_repeaters = 0, reps = 1;
+
+	if (req->type == SNMP_GETBULK) {
+		non_repeaters = req->error_status;
+		reps = req->error_index;
+		if (non_repeaters > req->nb_varbinds)
+			non_repeaters = req->nb_varbinds;
+	}
+	for (i = 0; i < req->nb_varbinds && n < VARBINDS_MAX; i++)
+		if (req->type != SNMP_GETBULK || i < non_repeaters)
+			lookup(&req->varbinds[i].oid, req->type != SNMP_GET,
+			       out + n++);
+	/* Rows of the repeated varbinds, each following the previous row */
+	for (r = 0; req->type == SNMP_GETBULK && r < reps; r++)
+		for (i = non_repeaters; i < req->nb_varbinds
+		     && n < VARBINDS_MAX; i++) {
+			const struct snmp_oid *from = r == 0 ?
+			    &req->varbinds[i].oid :
+			    &out[n - (req->nb_varbinds - non_repeaters)].oid;
+
+			lookup(from, true, out + n);
+			n++;
+		}
+
+	resp->type = SNMP_RESPONSE;
+	resp->request_id = req->request_id;
+	resp->error_status = 0;
+	resp->error_index = 0;
+	resp->varbinds = out;
+	resp->nb_varbinds = n;
+}
+
+int main(int argc, char *argv[])
+{
+	static uint8_t buf[SNMP_MSG_MAX];
+	static struct snmp_varbind in[VARBINDS_MAX];
+	struct timeval idle = { 30, 0 };
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	const char *community = "public";
+	char tmp[4096], name[128];
+	int opt, fd, drops = 0;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "c:d:")) != -1)
+		switch (opt) {
+		case 'c':
+			community = optarg;
+			break;
+		case 'd':
+			drops = atoi(optarg);
+			break;
+		default:
+			return 2;
+		}
+	if (argc - optind != 2) {
+		fprintf(stderr, "usage: %s [-c community] [-d drops] "
+			"port_file walk_file\n", argv[0]);
+		return 2;
+	}
+	if (load(argv[optind + 1]) < 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0
+	    || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+	    || getsockname(fd, (struct sockaddr *) &addr, &addr_len) < 0
+	    || setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle,
+			  sizeof(idle)) < 0) {
+		perror("cannot listen");
+		return 1;
+	}
+	snprintf(tmp, sizeof(tmp), "%s.tmp", argv[optind]);
+	if (!(f = fopen(tmp, "w"))) {
+		perror(tmp);
+		return 1;
+	}
+	fprintf(f, "%u\n", ntohs(addr.sin_port));
+	fclose(f);
+	rename(tmp, argv[optind]);
+
+	for (;;) {
+		struct sockaddr_storage from;
+		socklen_t from_len = sizeof(from);
+		struct snmp_pdu req, resp;
+		ssize_t len;
+
+		len = recvfrom(fd, buf, sizeof(buf), 0,
+			       (struct sockaddr *) &from, &from_len);
+		if (len < 0)
+			return 0;
+		req.varbinds = in;
+		req.nb_varbinds = VARBINDS_MAX;
+		if (snmp_decode(buf, len, name, sizeof(name), &req) < 0
+		    || strcmp(name, community))
+			continue;
+		if (drops > 0) {
+			drops--;
+			continue;
+		}
+		answer(&req, &resp);
+		if ((len = snmp_encode(buf, sizeof(buf), community, &resp)) > 0)
+			sendto(fd, buf, len, 0, (struct sockaddr *) &from,
+			       from_len);
+	}
+}